@@ -0,0 +1,362 @@
+/**
+ * @file bench.c
+ * @brief Medição de desempenho da biblioteca de grafos (make bench).
+ *
+ * Para cada família e tamanho, gera um grafo com gera_grafo e mede
+ * separadamente a leitura e cada consulta. Cada medida roda em um processo
+ * filho, para que o pico de memória (ru_maxrss) seja o da própria medida e
+ * uma consulta lenta possa ser interrompida sem perder as demais.
+ * A saída tem um objeto JSON por linha.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "grafo.h"
+
+//------------------------------------------------------------------------------
+// Uso: bench_grafo [-g gerador] [-f familias] [-o ordens] [-r repeticoes]
+//                  [-T limite] [tamanho ...]
+//
+//   -g gerador    caminho do gera_grafo (padrão: ./gera_grafo)
+//   -f familias   famílias separadas por vírgula; o sufixo _pesos gera
+//                 arestas com pesos entre 0 e 100 e o sufixo _embaralhado
+//                 embaralha as linhas do arquivo (padrão: todas)
+//   -o ordens     numerações dos vértices medidas (define_reordenacao),
+//                 separadas por vírgula: nenhuma, rcm ou grau
+//                 (padrão: nenhuma,rcm)
+//   -r repeticoes medidas de cada fase; vale a menor (padrão: 1)
+//   -T limite     segundos até interromper uma medida (padrão: 60)
+//   tamanho       números de vértices (padrão: 1000 10000 100000)
+//
+// Cada medida produz uma linha
+//   {"familia": ..., "tamanho": ..., "bytes": ..., "ordem": ..., "fase": ...,
+//    "vertices": ..., "arestas": ..., "segundos": ..., "vertices_por_segundo": ...,
+//    "arestas_por_segundo": ..., "rss_kb": ...}
+// (com "mb_por_segundo" nas fases de leitura, "aceleracao" nas ordens depois
+// da primeira, com o tempo da primeira ordem dividido pelo desta, ou
+// "esgotado": true se a medida passou do limite). Nas fases de leitura o
+// tempo inclui a renumeração. Cada fase medida em dois ou mais tamanhos
+// produz uma linha de escala
+//   {"familia": ..., "ordem": ..., "fase": ..., "escala": ...}
+// com o expoente k de segundos ~ (vertices + arestas)^k, ajustado por
+// mínimos quadrados em escala logarítmica.
+static void uso(void) {
+  fprintf(stderr, "uso: bench_grafo [-g gerador] [-f familias] [-o ordens] "
+                  "[-r repeticoes] [-T limite] [tamanho ...]\n");
+  exit(2);
+}
+
+static const char *familias_padrao =
+  "aleatorio,aleatorio_pesos,potencia,potencia_pesos,grade,grade_pesos,"
+  "grade_embaralhado,caminho,ciclo,pequenos";
+
+static const char *ordens_padrao = "nenhuma,rcm";
+
+#define MAX_ORDENS 3
+
+static const char *nomes_ordens[MAX_ORDENS] = { "nenhuma", "rcm", "grau" };
+static const unsigned int valores_ordens[MAX_ORDENS] = {
+  REORDENACAO_NENHUMA, REORDENACAO_RCM, REORDENACAO_GRAU
+};
+
+static const long tamanhos_padrao[] = { 1000, 10000, 100000 };
+
+//------------------------------------------------------------------------------
+// Fases medidas. As de leitura medem a leitura do arquivo; as demais leem o
+// grafo com le_grafo_arquivo antes de começar a medir, e cada uma parte de
+// um grafo recém-lido (sem resultados de consultas anteriores). A fase
+// distancia prepara o índice de marcos fora da medida e mede
+// CONSULTAS_DISTANCIA consultas entre pares sorteados.
+enum fase {
+  F_LE_GRAFO, F_LE_GRAFO_ARQUIVO, F_LE_GRAFO_STREAM,
+  F_N_COMPONENTES, F_BIPARTIDO, F_DIAMETROS, F_VERTICES_CORTE,
+  F_ARESTAS_CORTE, F_N_BLOCOS, F_ANALISA_GRAFO, F_N_TRIANGULOS,
+  F_PREPARA_DISTANCIAS, F_DISTANCIA,
+  N_FASES
+};
+
+static const char *nomes_fases[N_FASES] = {
+  "le_grafo", "le_grafo_arquivo", "le_grafo_stream",
+  "n_componentes", "bipartido", "diametros", "vertices_corte",
+  "arestas_corte", "n_blocos", "analisa_grafo", "n_triangulos",
+  "prepara_distancias", "distancia"
+};
+
+#define CONSULTAS_DISTANCIA 1000
+
+// Resultado de uma medida, enviado do processo filho pelo pipe
+typedef struct medida {
+  double segundos;
+  long   rss_kb;
+  long   vertices;
+  long   arestas;
+} medida;
+
+static double agora(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+}
+
+//------------------------------------------------------------------------------
+// Executa a fase no processo corrente e preenche m
+static void executa(enum fase fase, const char *arquivo, medida *m) {
+  struct grafo *g = NULL;
+  double t0;
+  char *s = NULL;
+
+  if (fase <= F_LE_GRAFO_STREAM) {
+    t0 = agora();
+    if (fase == F_LE_GRAFO_ARQUIVO) {
+      g = le_grafo_arquivo(arquivo);
+    } else {
+      FILE *f = fopen(arquivo, "r");
+      if (!f) exit(1);
+      g = fase == F_LE_GRAFO ? le_grafo(f) : le_grafo_stream(f);
+      fclose(f);
+    }
+    m->segundos = agora() - t0;
+  } else {
+    g = le_grafo_arquivo(arquivo);
+    if (!g) exit(1);
+    int n = (int)n_vertices(g);
+    if (fase == F_DISTANCIA) prepara_distancias(g, 0);
+    t0 = agora();
+    switch (fase) {
+    case F_N_COMPONENTES:  n_componentes(g); break;
+    case F_BIPARTIDO:      bipartido(g); break;
+    case F_DIAMETROS:      s = diametros(g); break;
+    case F_VERTICES_CORTE: s = vertices_corte(g); break;
+    case F_ARESTAS_CORTE:  s = arestas_corte(g); break;
+    case F_N_BLOCOS:       n_blocos(g); break;
+    case F_ANALISA_GRAFO:  analisa_grafo(g); break;
+    case F_N_TRIANGULOS:   n_triangulos(g); break;
+    case F_PREPARA_DISTANCIAS: prepara_distancias(g, 0); break;
+    case F_DISTANCIA:
+      srand(1);
+      for (int i = 0; n > 0 && i < CONSULTAS_DISTANCIA; i++) {
+        int u = rand() % n, v = rand() % n;
+        distancia(g, nome_vertice(g, u), nome_vertice(g, v));
+      }
+      break;
+    default: break;
+    }
+    m->segundos = agora() - t0;
+    free(s);
+  }
+  if (!g) exit(1);
+
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  m->rss_kb   = ru.ru_maxrss;
+  m->vertices = (long)n_vertices(g);
+  m->arestas  = (long)n_arestas(g);
+  destroi_grafo(g);
+}
+
+// Mede a fase em um processo filho, com a numeração de vértices dada por
+// ordem. Devolve 1 se a medida terminou, 0 se passou do limite de tempo e
+// -1 em caso de erro.
+static int mede(enum fase fase, const char *arquivo, unsigned int ordem,
+                unsigned int limite, medida *m) {
+  int fd[2];
+  if (pipe(fd) != 0) return -1;
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid < 0) {
+    close(fd[0]);
+    close(fd[1]);
+    return -1;
+  }
+  if (pid == 0) {
+    close(fd[0]);
+    alarm(limite);
+    define_reordenacao(ordem);
+    executa(fase, arquivo, m);
+    ssize_t w = write(fd[1], m, sizeof(*m));
+    _exit(w == (ssize_t)sizeof(*m) ? 0 : 1);
+  }
+  close(fd[1]);
+  ssize_t r = read(fd[0], m, sizeof(*m));
+  close(fd[0]);
+  int st;
+  waitpid(pid, &st, 0);
+  if (WIFSIGNALED(st) && WTERMSIG(st) == SIGALRM) return 0;
+  if (r != (ssize_t)sizeof(*m) || !WIFEXITED(st) || WEXITSTATUS(st) != 0) return -1;
+  return 1;
+}
+
+//------------------------------------------------------------------------------
+// Pontos (log tamanho, log segundos) de uma fase, para a linha de escala
+typedef struct curva {
+  int    n;
+  double x[64], y[64];
+} curva;
+
+static void escreve_escala(const char *familia, const char *ordem, enum fase fase,
+                           const curva *c) {
+  if (c->n < 2) return;
+  double sx = 0, sy = 0, sxx = 0, sxy = 0;
+  for (int i = 0; i < c->n; i++) {
+    sx  += c->x[i];
+    sy  += c->y[i];
+    sxx += c->x[i] * c->x[i];
+    sxy += c->x[i] * c->y[i];
+  }
+  double den = c->n * sxx - sx * sx;
+  if (den <= 0) return;
+  printf("{\"familia\": \"%s\", \"ordem\": \"%s\", \"fase\": \"%s\", \"escala\": %.3f}\n",
+         familia, ordem, nomes_fases[fase], (c->n * sxy - sx * sy) / den);
+}
+
+//------------------------------------------------------------------------------
+int main(int argc, char **argv) {
+
+  const char *gerador = "./gera_grafo";
+  const char *familias = familias_padrao, *ordens = ordens_padrao;
+  unsigned int limite = 60;
+  int repeticoes = 1, opt;
+
+  while ((opt = getopt(argc, argv, "g:f:o:r:T:")) != -1) {
+    switch (opt) {
+    case 'g': gerador = optarg; break;
+    case 'f': familias = optarg; break;
+    case 'o': ordens = optarg; break;
+    case 'r': repeticoes = atoi(optarg); break;
+    case 'T': limite = (unsigned int)strtoul(optarg, NULL, 10); break;
+    default: uso();
+    }
+  }
+  if (repeticoes < 1 || limite < 1) uso();
+
+  int n_tamanhos = argc - optind;
+  long *tamanhos = malloc(((size_t)n_tamanhos + 3) * sizeof(long));
+  if (!tamanhos) exit(EXIT_FAILURE);
+  for (int i = 0; i < n_tamanhos; i++) {
+    tamanhos[i] = strtol(argv[optind + i], NULL, 10);
+    if (tamanhos[i] < 1) uso();
+  }
+  if (n_tamanhos == 0) {
+    n_tamanhos = 3;
+    memcpy(tamanhos, tamanhos_padrao, sizeof(tamanhos_padrao));
+  }
+  if (n_tamanhos > 64) uso();
+
+  // Ordens pedidas, como índices em nomes_ordens
+  int ordem[MAX_ORDENS], n_ordens = 0;
+  for (const char *p = ordens; *p; ) {
+    size_t len = strcspn(p, ",");
+    int k = 0;
+    while (k < MAX_ORDENS && (strlen(nomes_ordens[k]) != len ||
+                              strncmp(p, nomes_ordens[k], len) != 0)) k++;
+    if (k == MAX_ORDENS || n_ordens == MAX_ORDENS) uso();
+    ordem[n_ordens++] = k;
+    p += len;
+    if (*p) p++;
+  }
+  if (n_ordens == 0) uso();
+
+  const char *tmp = getenv("TMPDIR");
+  char arquivo[4096];
+  snprintf(arquivo, sizeof(arquivo), "%s/grafo_bench_XXXXXX", tmp ? tmp : "/tmp");
+  int fd = mkstemp(arquivo);
+  if (fd < 0) {
+    perror("bench_grafo");
+    return 1;
+  }
+  close(fd);
+
+  char *lista = malloc(strlen(familias) + 1);
+  if (!lista) exit(EXIT_FAILURE);
+  strcpy(lista, familias);
+  int falhas = 0;
+
+  for (char *familia = strtok(lista, ","); familia; familia = strtok(NULL, ",")) {
+    char base[64];
+    size_t len = strcspn(familia, "_");
+    const char *sufixo = familia + len;
+    char opcoes[32];
+    snprintf(opcoes, sizeof(opcoes), "%s%s", strstr(sufixo, "_pesos") ? "-p 100 " : "",
+             strstr(sufixo, "_embaralhado") ? "-e " : "");
+    if (len >= sizeof(base)) len = sizeof(base) - 1;
+    memcpy(base, familia, len);
+    base[len] = '\0';
+
+    curva curvas[MAX_ORDENS][N_FASES];
+    memset(curvas, 0, sizeof(curvas));
+
+    for (int t = 0; t < n_tamanhos; t++) {
+      char cmd[8192];
+      snprintf(cmd, sizeof(cmd), "%s %s%s %ld > %s", gerador, opcoes, base, tamanhos[t], arquivo);
+      struct stat st;
+      if (system(cmd) != 0 || stat(arquivo, &st) != 0) {
+        fprintf(stderr, "bench_grafo: falha ao gerar %s %ld\n", familia, tamanhos[t]);
+        falhas++;
+        break;
+      }
+      // Tempo de cada fase na primeira ordem, base da aceleração das demais
+      double primeira[N_FASES];
+      for (int f = 0; f < N_FASES; f++) primeira[f] = 0;
+      for (int o = 0; o < n_ordens; o++) {
+        const char *nome_ordem = nomes_ordens[ordem[o]];
+        for (int f = 0; f < N_FASES; f++) {
+          medida m, melhor;
+          int ok = 0;
+          memset(&melhor, 0, sizeof(melhor));
+          for (int r = 0; r < repeticoes; r++) {
+            memset(&m, 0, sizeof(m));
+            ok = mede((enum fase)f, arquivo, valores_ordens[ordem[o]], limite, &m);
+            if (ok != 1) break;
+            if (r == 0 || m.segundos < melhor.segundos) melhor = m;
+          }
+          printf("{\"familia\": \"%s\", \"tamanho\": %ld, \"bytes\": %lld, "
+                 "\"ordem\": \"%s\", \"fase\": \"%s\", ",
+                 familia, tamanhos[t], (long long)st.st_size, nome_ordem, nomes_fases[f]);
+          if (ok == 0) {
+            printf("\"esgotado\": true, \"limite\": %u}\n", limite);
+            continue;
+          }
+          if (ok < 0) {
+            printf("\"erro\": true}\n");
+            falhas++;
+            continue;
+          }
+          double s = melhor.segundos > 1e-9 ? melhor.segundos : 1e-9;
+          printf("\"vertices\": %ld, \"arestas\": %ld, \"segundos\": %.6f, "
+                 "\"vertices_por_segundo\": %.0f, \"arestas_por_segundo\": %.0f, ",
+                 melhor.vertices, melhor.arestas, melhor.segundos,
+                 (double)melhor.vertices / s, (double)melhor.arestas / s);
+          if (f <= F_LE_GRAFO_STREAM)
+            printf("\"mb_por_segundo\": %.1f, ", (double)st.st_size / s / 1e6);
+          if (o == 0) primeira[f] = s;
+          else if (primeira[f] > 0) printf("\"aceleracao\": %.2f, ", primeira[f] / s);
+          printf("\"rss_kb\": %ld}\n", melhor.rss_kb);
+
+          curva *c = &curvas[o][f];
+          c->x[c->n] = log((double)(melhor.vertices + melhor.arestas + 1));
+          c->y[c->n] = log(s);
+          c->n++;
+        }
+      }
+    }
+    for (int o = 0; o < n_ordens; o++) {
+      for (int f = 0; f < N_FASES; f++)
+        escreve_escala(familia, nomes_ordens[ordem[o]], (enum fase)f, &curvas[o][f]);
+    }
+  }
+
+  remove(arquivo);
+  free(lista);
+  free(tamanhos);
+  return falhas ? 1 : 0;
+}
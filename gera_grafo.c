@@ -0,0 +1,224 @@
+/**
+ * @file gera_grafo.c
+ * @brief Gerador de grafos sintéticos no formato de entrada de le_grafo,
+ *        usado pelo programa de medição (make bench).
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+//------------------------------------------------------------------------------
+// Uso: gera_grafo [-s semente] [-p peso_max] [-g grau] [-e] familia n
+//
+// Escreve na saída padrão um grafo com cerca de n vértices da família dada:
+//   aleatorio  Erdős–Rényi esparso, n * grau / 2 arestas entre pares sorteados
+//   potencia   preferencial (Barabási–Albert): cada vértice novo liga-se a
+//              grau / 2 vértices escolhidos com probabilidade proporcional
+//              ao grau, o que produz graus em lei de potência
+//   grade      grade quadrada com lado ceil(sqrt(n))
+//   caminho    caminho simples com n vértices
+//   ciclo      ciclo com n vértices
+//   pequenos   muitos componentes de 1 a 4 vértices (isolados, arestas,
+//              caminhos e triângulos)
+//   -s semente semente do gerador pseudoaleatório (padrão: 1)
+//   -p peso    pesos sorteados entre 0 e peso; sem -p as arestas não têm peso
+//   -g grau    grau médio de aleatorio e potencia (padrão: 8)
+//   -e         embaralha as linhas de vértices e arestas, como em um despejo
+//              de arestas sem ordem
+//
+// Os nomes dos vértices são "v" seguido de uma permutação aleatória de
+// 0 .. n - 1, para que a ordem de leitura não coincida com a numeração. A
+// ordem das linhas segue a estrutura da família (a grade linha a linha, o
+// caminho do início ao fim), a menos que se use -e.
+static void uso(void) {
+  fprintf(stderr, "uso: gera_grafo [-s semente] [-p peso_max] [-g grau] [-e] "
+                  "aleatorio|potencia|grade|caminho|ciclo|pequenos n\n");
+  exit(2);
+}
+
+//------------------------------------------------------------------------------
+// xorshift64*: rápido e suficiente para gerar entradas de teste
+static uint64_t estado = 1;
+
+static uint64_t sorteia(void) {
+  estado ^= estado >> 12;
+  estado ^= estado << 25;
+  estado ^= estado >> 27;
+  return estado * 2685821657736338717ull;
+}
+
+// Inteiro uniforme em [0, n)
+static long sorteia_ate(long n) {
+  return (long)(sorteia() % (uint64_t)n);
+}
+
+//------------------------------------------------------------------------------
+static long *nomes;
+static long  peso_max = -1;
+static FILE *saida;              // stdout ou, com -e, o buffer a embaralhar
+
+static void vertice(long u) {
+  fprintf(saida, "v%ld\n", nomes[u]);
+}
+
+static void aresta(long u, long v) {
+  if (peso_max >= 0)
+    fprintf(saida, "v%ld -- v%ld %ld\n", nomes[u], nomes[v], sorteia_ate(peso_max + 1));
+  else
+    fprintf(saida, "v%ld -- v%ld\n", nomes[u], nomes[v]);
+}
+
+// Escreve na saída padrão as linhas do buffer em ordem aleatória
+static void embaralha(char *buf, size_t len) {
+  long n = 0, cap = 1024;
+  char **linhas = malloc((size_t)cap * sizeof(char *));
+  if (!linhas) exit(EXIT_FAILURE);
+  for (char *p = buf; p < buf + len; ) {
+    char *nl = memchr(p, '\n', (size_t)(buf + len - p));
+    if (n == cap) {
+      cap *= 2;
+      linhas = realloc(linhas, (size_t)cap * sizeof(char *));
+      if (!linhas) exit(EXIT_FAILURE);
+    }
+    linhas[n++] = p;
+    p = nl ? nl + 1 : buf + len;
+  }
+  for (long i = n - 1; i > 0; i--) {
+    long j = sorteia_ate(i + 1);
+    char *t = linhas[i];
+    linhas[i] = linhas[j];
+    linhas[j] = t;
+  }
+  for (long i = 0; i < n; i++) fwrite(linhas[i], 1, strcspn(linhas[i], "\n") + 1, stdout);
+  free(linhas);
+}
+
+//------------------------------------------------------------------------------
+static void aleatorio(long n, long grau) {
+  long m = n * grau / 2;
+  for (long i = 0; i < n; i++) vertice(i);
+  if (n < 2) return;
+  for (long i = 0; i < m; i++) {
+    long u = sorteia_ate(n), v = sorteia_ate(n - 1);
+    aresta(u, v >= u ? v + 1 : v);
+  }
+}
+
+static void potencia(long n, long grau) {
+  long k = grau / 2 > 0 ? grau / 2 : 1;
+  // Cada aresta deixa seus dois extremos na lista: sortear uma posição
+  // escolhe um vértice com probabilidade proporcional ao grau
+  long *pontas = malloc((size_t)(2 * n * k + 2) * sizeof(long));
+  if (!pontas) exit(EXIT_FAILURE);
+  long np = 0;
+  vertice(0);
+  for (long u = 1; u < n; u++) {
+    for (long j = 0; j < k && j < u; j++) {
+      long v = np ? pontas[sorteia_ate(np)] : 0;
+      aresta(u, v);
+      pontas[np++] = u;
+      pontas[np++] = v;
+    }
+  }
+  free(pontas);
+}
+
+// Menor lado de uma grade quadrada com ao menos n vértices
+static long lado_grade(long n) {
+  long lado = 1;
+  while (lado * lado < n) lado++;
+  return lado;
+}
+
+static void grade(long n) {
+  long lado = lado_grade(n);
+  for (long r = 0; r < lado; r++) {
+    for (long c = 0; c < lado; c++) {
+      long u = r * lado + c;
+      if (c + 1 < lado) aresta(u, u + 1);
+      if (r + 1 < lado) aresta(u, u + lado);
+      if (lado == 1) vertice(u);
+    }
+  }
+}
+
+static void caminho(long n, int fecha) {
+  if (n == 1) vertice(0);
+  for (long u = 0; u + 1 < n; u++) aresta(u, u + 1);
+  if (fecha && n > 2) aresta(n - 1, 0);
+}
+
+static void pequenos(long n) {
+  long u = 0;
+  while (u < n) {
+    long t = 1 + sorteia_ate(4);
+    if (u + t > n) t = n - u;
+    if (t == 1) vertice(u);
+    for (long i = 0; i + 1 < t; i++) aresta(u + i, u + i + 1);
+    if (t == 3 && sorteia_ate(2)) aresta(u + 2, u);
+    u += t;
+  }
+}
+
+//------------------------------------------------------------------------------
+int main(int argc, char **argv) {
+
+  long grau = 8;
+  int opt, embaralhado = 0;
+
+  while ((opt = getopt(argc, argv, "s:p:g:e")) != -1) {
+    switch (opt) {
+    case 's': estado = strtoull(optarg, NULL, 10) | 1; break;
+    case 'p': peso_max = strtol(optarg, NULL, 10); break;
+    case 'g': grau = strtol(optarg, NULL, 10); break;
+    case 'e': embaralhado = 1; break;
+    default: uso();
+    }
+  }
+  if (argc - optind != 2 || grau < 1) uso();
+
+  const char *familia = argv[optind];
+  long n = strtol(argv[optind + 1], NULL, 10);
+  if (n < 1) uso();
+
+  // A grade arredonda n para o quadrado seguinte
+  long total = n;
+  if (strcmp(familia, "grade") == 0) {
+    long lado = lado_grade(n);
+    total = lado * lado;
+  }
+  nomes = malloc((size_t)total * sizeof(long));
+  if (!nomes) exit(EXIT_FAILURE);
+  for (long i = 0; i < total; i++) nomes[i] = i;
+  for (long i = total - 1; i > 0; i--) {
+    long j = sorteia_ate(i + 1), t = nomes[i];
+    nomes[i] = nomes[j];
+    nomes[j] = t;
+  }
+
+  printf("// gerado por gera_grafo\n%s_%ld\n", familia, n);
+  char *buf = NULL;
+  size_t len = 0;
+  saida = embaralhado ? open_memstream(&buf, &len) : stdout;
+  if (!saida) exit(EXIT_FAILURE);
+  if (strcmp(familia, "aleatorio") == 0)     aleatorio(n, grau);
+  else if (strcmp(familia, "potencia") == 0) potencia(n, grau);
+  else if (strcmp(familia, "grade") == 0)    grade(n);
+  else if (strcmp(familia, "caminho") == 0)  caminho(n, 0);
+  else if (strcmp(familia, "ciclo") == 0)    caminho(n, 1);
+  else if (strcmp(familia, "pequenos") == 0) pequenos(n);
+  else uso();
+  if (embaralhado) {
+    if (fclose(saida) != 0) exit(EXIT_FAILURE);
+    embaralha(buf, len);
+    free(buf);
+  }
+
+  free(nomes);
+  return ferror(stdout) ? 1 : 0;
+}
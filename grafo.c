@@ -8,28 +8,484 @@
  * @date 2023-10-01
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include "grafo.h"
+#include <stddef.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <ctype.h>
 #include <limits.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+
+//------------------------------------------------------------------------------
+// Arena de memória do grafo
+//
+// Todas as estruturas de um grafo são alocadas de uma arena própria.
+// Alocações pequenas são servidas sequencialmente de blocos ("slabs") cujo
+// tamanho cresce geometricamente; alocações grandes ganham um bloco exclusivo,
+// que pode ser redimensionado com realloc ou devolvido isoladamente.
+// destroi_grafo libera a arena inteira percorrendo apenas a lista de blocos.
+
+#define ARENA_ALIGN      16
+#define ARENA_FIRST_SLAB ((size_t)64 * 1024)
+#define ARENA_MAX_SLAB   ((size_t)8 * 1024 * 1024)
+#define ARENA_LARGE      ((size_t)32 * 1024)
+
+/**
+ * Cabeçalho de um bloco da arena. Os dados começam logo após o cabeçalho.
+ */
+typedef struct arena_block {
+    struct arena_block *prev;
+    struct arena_block *next;
+    size_t size;          // bytes de dados do bloco
+    size_t pad;           // mantém os dados alinhados a ARENA_ALIGN
+} arena_block;
+
+struct arena {
+    arena_block *blocks;  // lista duplamente encadeada de todos os blocos
+    arena_block *slab;    // slab corrente
+    size_t slab_used;     // bytes já entregues do slab corrente
+    size_t next_slab;     // tamanho do próximo slab
+    void *last;           // última alocação feita no slab corrente
+    size_t reserved;      // bytes obtidos do sistema (cabeçalhos inclusos)
+    size_t used;          // bytes entregues a estruturas vivas
+    unsigned int n_blocks;
+    unsigned long n_allocs;
+    size_t allocated;     // total de bytes já entregues (não diminui)
+};
+
+static size_t arena_round(size_t size) {
+    return (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+/**
+ * Obtém do sistema um novo bloco e o encadeia no início da lista.
+ * @param a arena
+ * @param size bytes de dados do bloco
+ * @return bloco alocado
+ */
+static arena_block *arena_new_block(struct arena *a, size_t size) {
+    arena_block *b = malloc(sizeof(arena_block) + size);
+    if (!b) exit(EXIT_FAILURE);
+    b->size = size;
+    b->prev = NULL;
+    b->next = a->blocks;
+    if (a->blocks) a->blocks->prev = b;
+    a->blocks = b;
+    a->reserved += sizeof(arena_block) + size;
+    a->n_blocks++;
+    return b;
+}
+
+static void arena_unlink(struct arena *a, arena_block *b) {
+    if (b->prev) b->prev->next = b->next;
+    else a->blocks = b->next;
+    if (b->next) b->next->prev = b->prev;
+    a->reserved -= sizeof(arena_block) + b->size;
+    a->n_blocks--;
+}
+
+/**
+ * Cria uma arena vazia. A própria estrutura da arena mora no primeiro slab.
+ * @return arena criada
+ */
+static struct arena *arena_create(void) {
+    struct arena tmp;
+    memset(&tmp, 0, sizeof(tmp));
+    arena_block *b = arena_new_block(&tmp, ARENA_FIRST_SLAB);
+    struct arena *a = (struct arena *)(void *)(b + 1);
+    *a = tmp;
+    a->slab      = b;
+    a->slab_used = arena_round(sizeof(struct arena));
+    a->next_slab = 2 * ARENA_FIRST_SLAB;
+    return a;
+}
+
+/**
+ * Aloca size bytes da arena, alinhados a ARENA_ALIGN.
+ * @param a arena
+ * @param size bytes a alocar
+ * @return ponteiro para a memória (nunca NULL)
+ */
+static void *arena_alloc(struct arena *a, size_t size) {
+    size = arena_round(size ? size : 1);
+    a->used += size;
+    a->allocated += size;
+    a->n_allocs++;
+    if (size >= ARENA_LARGE) {
+        return arena_new_block(a, size) + 1;
+    }
+    if (a->slab_used + size > a->slab->size) {
+        a->slab      = arena_new_block(a, a->next_slab);
+        a->slab_used = 0;
+        if (a->next_slab < ARENA_MAX_SLAB) a->next_slab *= 2;
+    }
+    void *p = (char *)(a->slab + 1) + a->slab_used;
+    a->slab_used += size;
+    a->last = p;
+    return p;
+}
+
+/**
+ * Devolve uma alocação à arena. Blocos exclusivos voltam ao sistema; o espaço
+ * de alocações pequenas só é recuperado quando a arena é destruída.
+ * @param a arena
+ * @param p ponteiro devolvido por arena_alloc ou arena_realloc (pode ser NULL)
+ * @param size tamanho pedido na alocação
+ */
+static void arena_release(struct arena *a, void *p, size_t size) {
+    if (!p) return;
+    size = arena_round(size ? size : 1);
+    a->used -= size;
+    if (size >= ARENA_LARGE) {
+        arena_block *b = (arena_block *)p - 1;
+        arena_unlink(a, b);
+        free(b);
+    }
+}
+
+/**
+ * Redimensiona uma alocação da arena, preservando o conteúdo.
+ * Blocos exclusivos são redimensionados com realloc e a última alocação do
+ * slab corrente cresce no próprio lugar quando há espaço; nos demais casos
+ * o conteúdo é copiado para uma nova alocação.
+ * @param a arena
+ * @param p alocação atual (ou NULL)
+ * @param old tamanho pedido na alocação atual
+ * @param size novo tamanho
+ * @return ponteiro para a alocação redimensionada
+ */
+static void *arena_realloc(struct arena *a, void *p, size_t old, size_t size) {
+    if (!p) return arena_alloc(a, size);
+    size_t r_old = arena_round(old ? old : 1);
+    size_t r_new = arena_round(size ? size : 1);
+    if (r_old >= ARENA_LARGE && r_new >= ARENA_LARGE) {
+        arena_block *b = (arena_block *)p - 1;
+        arena_block *prev = b->prev, *next = b->next;
+        arena_block *nb = realloc(b, sizeof(arena_block) + r_new);
+        if (!nb) exit(EXIT_FAILURE);
+        if (prev) prev->next = nb;
+        else a->blocks = nb;
+        if (next) next->prev = nb;
+        a->reserved += r_new - nb->size;
+        a->used     += r_new - r_old;
+        if (r_new > r_old) a->allocated += r_new - r_old;
+        nb->size = r_new;
+        return nb + 1;
+    }
+    if (p == a->last && r_new < ARENA_LARGE &&
+        a->slab_used - r_old + r_new <= a->slab->size) {
+        a->slab_used += r_new - r_old;
+        a->used      += r_new - r_old;
+        if (r_new > r_old) a->allocated += r_new - r_old;
+        return p;
+    }
+    void *q = arena_alloc(a, size);
+    memcpy(q, p, old < size ? old : size);
+    arena_release(a, p, old);
+    return q;
+}
+
+/**
+ * Libera todos os blocos da arena, inclusive o que contém a própria arena.
+ * @param a arena
+ */
+static void arena_destroy(struct arena *a) {
+    arena_block *b = a->blocks;
+    while (b) {
+        arena_block *next = b->next;
+        free(b);
+        b = next;
+    }
+}
+
+//------------------------------------------------------------------------------
+// Instrumentação
+//
+// Desligada por padrão. Quando ligada (define_instrumentacao ou a variável
+// de ambiente GRAFO_INSTRUMENTACAO), cada função pública que trabalha sobre
+// o grafo abre uma sonda: mede o tempo de parede e as alocações da arena e
+// recebe as contagens dos núcleos (vértices e arestas visitados, buscas,
+// operações no heap). A sonda aberta fica em uma variável da thread, e não
+// no grafo, para que consultas que só leem o grafo possam rodar ao mesmo
+// tempo em threads diferentes; run_parallel a repassa às suas threads. Os
+// núcleos só consultam a sonda fora dos laços internos, de modo que,
+// desligada, a instrumentação custa um teste por chamada.
+
+enum fase_id {
+    FASE_LE_GRAFO, FASE_LE_GRAFO_ARQUIVO, FASE_LE_GRAFO_STREAM,
+    FASE_CARREGA_BINARIO, FASE_SALVA_BINARIO, FASE_DESTROI,
+    FASE_ADICIONA_VERTICE, FASE_ADICIONA_ARESTA, FASE_REMOVE_ARESTA,
+    FASE_INDICE_VERTICE, FASE_N_COMPONENTES, FASE_BIPARTIDO,
+    FASE_DIAMETROS, FASE_ESCREVE_DIAMETROS, FASE_VERTICES_CORTE,
+    FASE_ESCREVE_VERTICES_CORTE, FASE_ARESTAS_CORTE, FASE_ESCREVE_ARESTAS_CORTE,
+    FASE_N_BLOCOS, FASE_ANALISA_GRAFO, FASE_N_TRIANGULOS,
+    FASE_COEFICIENTE_AGRUPAMENTO, FASE_COEFICIENTE_AGRUPAMENTO_MEDIO,
+    FASE_COEFICIENTE_AGRUPAMENTO_LOCAL, FASE_DISTANCIA, FASE_PREPARA_DISTANCIAS,
+    FASE_SALVA_INDICE_DISTANCIAS, FASE_CARREGA_INDICE_DISTANCIAS,
+    N_FASES
+};
+
+static const char *const fase_names[N_FASES] = {
+    "le_grafo", "le_grafo_arquivo", "le_grafo_stream",
+    "carrega_grafo_binario", "salva_grafo_binario", "destroi_grafo",
+    "adiciona_vertice", "adiciona_aresta", "remove_aresta",
+    "indice_vertice", "n_componentes", "bipartido",
+    "diametros", "escreve_diametros", "vertices_corte",
+    "escreve_vertices_corte", "arestas_corte", "escreve_arestas_corte",
+    "n_blocos", "analisa_grafo", "n_triangulos",
+    "coeficiente_agrupamento", "coeficiente_agrupamento_medio",
+    "coeficiente_agrupamento_local", "distancia", "prepara_distancias",
+    "salva_indice_distancias", "carrega_indice_distancias"
+};
+
+// Totais acumulados por fase; atualizados com operações atômicas
+typedef struct phase_totals {
+    unsigned long calls;
+    unsigned long long nanos;
+    unsigned long allocs;
+    unsigned long long bytes;
+    unsigned long long vertices, edges, searches, heap_ops;
+} phase_totals;
+
+static phase_totals phase_stats[N_FASES];
+
+// Sonda que recebe as contagens dos núcleos executados nesta thread
+static __thread struct sonda *probe_current;
+
+// -1 = ainda não consultou o ambiente
+static int instr_config = -1;
+
+/**
+ * Medição de uma chamada de função pública, guardada na pilha de quem chama.
+ * Os contadores recebem somas atômicas, pois as threads de run_parallel
+ * também contribuem.
+ */
+struct sonda {
+    int phase;            // fase medida ou -1 se a instrumentação está desligada
+    struct sonda *outer;  // sonda anterior da thread (chamadas aninhadas)
+    struct timespec t0;
+    unsigned long allocs0;
+    size_t bytes0;
+    unsigned long long vertices, edges, searches, heap_ops;
+};
+
+void define_instrumentacao(unsigned int ativa) {
+    __atomic_store_n(&instr_config, ativa ? 1 : 0, __ATOMIC_RELAXED);
+}
+
+static int instr_enabled(void) {
+    int on = __atomic_load_n(&instr_config, __ATOMIC_RELAXED);
+    if (on < 0) {
+        const char *env = getenv("GRAFO_INSTRUMENTACAO");
+        on = env && *env && strcmp(env, "0") != 0;
+        __atomic_store_n(&instr_config, on, __ATOMIC_RELAXED);
+    }
+    return on;
+}
+
+/**
+ * Abre a medição de uma fase. Com g != NULL, a sonda passa a receber as
+ * contagens dos núcleos executados sobre g nesta thread.
+ */
+static void probe_begin(struct grafo *g, struct sonda *p, enum fase_id phase) {
+    p->phase = -1;
+    if (!instr_enabled()) return;
+    memset(p, 0, sizeof(*p));
+    p->phase = (int)phase;
+    clock_gettime(CLOCK_MONOTONIC, &p->t0);
+    if (g) {
+        p->allocs0 = g->mem->n_allocs;
+        p->bytes0  = g->mem->allocated;
+        p->outer   = probe_current;
+        probe_current = p;
+    }
+}
+
+/**
+ * Fecha a medição e a soma aos totais da fase. g é o grafo ao final da
+ * chamada (o criado, nas funções de leitura, ou NULL se já foi destruído);
+ * created indica que g nasceu durante a chamada.
+ */
+static void probe_finish(struct grafo *g, struct sonda *p, int created) {
+    if (p->phase < 0) return;
+    struct timespec t1;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    unsigned long allocs = 0;
+    size_t bytes = 0;
+    if (g) {
+        allocs = g->mem->n_allocs - p->allocs0;
+        bytes  = g->mem->allocated - p->bytes0;
+        if (!created) probe_current = p->outer;
+    }
+    phase_totals *t = &phase_stats[p->phase];
+    long long ns = (long long)(t1.tv_sec - p->t0.tv_sec) * 1000000000LL +
+                   (t1.tv_nsec - p->t0.tv_nsec);
+    __atomic_fetch_add(&t->calls, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&t->nanos, (unsigned long long)ns, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&t->allocs, allocs, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&t->bytes, (unsigned long long)bytes, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&t->vertices, p->vertices, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&t->edges, p->edges, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&t->searches, p->searches, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&t->heap_ops, p->heap_ops, __ATOMIC_RELAXED);
+}
+
+static void probe_end(struct grafo *g, struct sonda *p) {
+    probe_finish(g, p, 0);
+}
+
+/**
+ * Fecha a medição de uma função de leitura, contando como visitados os
+ * vértices e arestas lidos.
+ */
+static void probe_loaded(struct grafo *g, struct sonda *p) {
+    if (p->phase >= 0 && g) {
+        p->vertices += (unsigned long long)g->n_vertices;
+        p->edges    += (unsigned long long)g->n_arestas;
+    }
+    probe_finish(g, p, 1);
+}
+
+/**
+ * Soma contagens de um núcleo à sonda aberta nesta thread, se houver.
+ */
+static void probe_count(unsigned long long vertices, unsigned long long edges,
+                        unsigned long long searches, unsigned long long heap_ops) {
+    struct sonda *p = probe_current;
+    if (!p) return;
+    __atomic_fetch_add(&p->vertices, vertices, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&p->edges, edges, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&p->searches, searches, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&p->heap_ops, heap_ops, __ATOMIC_RELAXED);
+}
+
+unsigned int le_instrumentacao(struct grafo_fase *fases, unsigned int max) {
+    unsigned int n = 0;
+    for (int i = 0; i < N_FASES; i++) {
+        phase_totals *t = &phase_stats[i];
+        unsigned long calls = __atomic_load_n(&t->calls, __ATOMIC_RELAXED);
+        if (!calls) continue;
+        if (fases && n < max) {
+            struct grafo_fase *f = &fases[n];
+            f->funcao     = fase_names[i];
+            f->chamadas   = calls;
+            f->segundos   = (double)__atomic_load_n(&t->nanos, __ATOMIC_RELAXED) * 1e-9;
+            f->alocacoes  = __atomic_load_n(&t->allocs, __ATOMIC_RELAXED);
+            f->bytes      = __atomic_load_n(&t->bytes, __ATOMIC_RELAXED);
+            f->vertices   = __atomic_load_n(&t->vertices, __ATOMIC_RELAXED);
+            f->arestas    = __atomic_load_n(&t->edges, __ATOMIC_RELAXED);
+            f->buscas     = __atomic_load_n(&t->searches, __ATOMIC_RELAXED);
+            f->operacoes_heap = __atomic_load_n(&t->heap_ops, __ATOMIC_RELAXED);
+        }
+        n++;
+    }
+    return n;
+}
+
+void zera_instrumentacao(void) {
+    for (int i = 0; i < N_FASES; i++) {
+        phase_totals *t = &phase_stats[i];
+        __atomic_store_n(&t->calls, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&t->nanos, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&t->allocs, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&t->bytes, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&t->vertices, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&t->edges, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&t->searches, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&t->heap_ops, 0, __ATOMIC_RELAXED);
+    }
+}
+
+unsigned int escreve_instrumentacao(FILE *f) {
+    if (!f) return 0;
+    struct grafo_fase fases[N_FASES];
+    unsigned int n = le_instrumentacao(fases, N_FASES);
+    fprintf(f, "{\"fases\": [");
+    for (unsigned int i = 0; i < n; i++) {
+        struct grafo_fase *p = &fases[i];
+        fprintf(f, "%s\n  {\"funcao\": \"%s\", \"chamadas\": %lu, \"segundos\": %.9f, "
+                   "\"alocacoes\": %lu, \"bytes\": %llu, \"vertices\": %llu, "
+                   "\"arestas\": %llu, \"buscas\": %llu, \"operacoes_heap\": %llu}",
+                i ? "," : "", p->funcao, p->chamadas, p->segundos, p->alocacoes,
+                p->bytes, p->vertices, p->arestas, p->buscas, p->operacoes_heap);
+    }
+    fprintf(f, "%s]}\n", n ? "\n" : "");
+    return !ferror(f);
+}
+
+//------------------------------------------------------------------------------
+/**
+ * Calcula o hash FNV-1a de um nome.
+ * @param s início do nome
+ * @param len tamanho do nome em bytes
+ * @return hash de 32 bits
+ */
+static unsigned int hash_name(const char *s, size_t len) {
+    unsigned int h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/**
+ * Devolve o nome do vértice i, guardado no pool de nomes.
+ * O ponteiro deixa de ser válido se novos vértices forem adicionados.
+ */
+static char *vertex_name(struct grafo *g, int i) {
+    return g->names.pool + g->names.offset[i];
+}
+
+/**
+ * Procura a posição da tabela hash onde está (ou deveria estar) o nome.
+ * @param g grafo a ser pesquisado
+ * @param name nome do vértice (não precisa terminar em '\0')
+ * @param len tamanho do nome
+ * @param h hash de name
+ * @return posição em g->names.slots
+ */
+static unsigned int find_slot(struct grafo *g, const char *name, size_t len, unsigned int h) {
+    name_table *t = &g->names;
+    unsigned int mask = t->n_slots - 1;
+    unsigned int i = h & mask;
+    while (t->slots[i].idx >= 0) {
+        if (t->slots[i].hash == h) {
+            const char *s = t->pool + t->offset[t->slots[i].idx];
+            if (memcmp(s, name, len) == 0 && s[len] == '\0') break;
+        }
+        i = (i + 1) & mask;
+    }
+    return i;
+}
 
 /**
- * Remove espaços em branco no início e no final de uma string.
- * @param str  string a ser "limpa"
- * @return ponteiro para a string limpa
+ * Dobra o tamanho da tabela hash, reinserindo as entradas a partir dos
+ * hashes guardados (sem recalcular nem comparar nomes).
+ * @param g grafo cuja tabela será redimensionada
  */
-static char *trim(char *str) {
-    char *end;
-    // Trim leading space
-    while (isspace((unsigned char)*str)) str++;
-    if (*str == '\0')
-        return str;
-    // Trim trailing space
-    end = str + strlen(str) - 1;
-    while (end > str && isspace((unsigned char)*end)) end--;
-    *(end + 1) = '\0';
-    return str;
+static void grow_slots(struct grafo *g) {
+    name_table *t = &g->names;
+    unsigned int n = t->n_slots ? t->n_slots * 2 : 64;
+    name_slot *slots = arena_alloc(g->mem, n * sizeof(name_slot));
+    for (unsigned int i = 0; i < n; i++) slots[i].idx = -1;
+    for (unsigned int i = 0; i < t->n_slots; i++) {
+        if (t->slots[i].idx < 0) continue;
+        unsigned int j = t->slots[i].hash & (n - 1);
+        while (slots[j].idx >= 0) j = (j + 1) & (n - 1);
+        slots[j] = t->slots[i];
+    }
+    arena_release(g->mem, t->slots, t->n_slots * sizeof(name_slot));
+    t->slots   = slots;
+    t->n_slots = n;
 }
 
 /**
@@ -39,46 +495,65 @@ static char *trim(char *str) {
  * @return  índice do vértice ou -1 se não existir
  */
 static int find_vertex_index(struct grafo *g, const char *name) {
-    for (int i = 0; i < g->n_vertices; i++) {
-        if (strcmp(g->vertices[i], name) == 0) {
-            return i;
-        }
-    }
-    return -1;
+    if (!g->names.n_slots) return -1;
+    size_t len = strlen(name);
+    return g->names.slots[find_slot(g, name, len, hash_name(name, len))].idx;
 }
+
 /**
- * Adiciona um novo vértice ao grafo.
+ * Adiciona um novo vértice ao grafo. O nome não pode existir no grafo.
  * @param g grafo onde o vértice será adicionado
- * @param name nome do vértice a ser adicionado
+ * @param name nome do vértice a ser adicionado (não precisa terminar em '\0')
+ * @param len tamanho do nome
+ * @param h hash de name
  * @return índice do novo vértice
  */
-static int add_vertex(struct grafo *g, const char *name) {
+static int add_vertex(struct grafo *g, const char *name, size_t len, unsigned int h) {
+    name_table *t = &g->names;
     int idx = g->n_vertices;
-    g->vertices = realloc(g->vertices, (idx + 1) * sizeof(char *));
-    g->adj = realloc(g->adj, (idx + 1) * sizeof(adj_node *));
-    if (!g->vertices || !g->adj) exit(EXIT_FAILURE);
 
-    g->vertices[idx] = malloc(strlen(name) + 1);
-    if (!g->vertices[idx]) exit(EXIT_FAILURE);
-    strcpy(g->vertices[idx], name);
+    // Mantém a carga da tabela hash em no máximo 1/2
+    if (2 * ((unsigned int)idx + 1) > t->n_slots) grow_slots(g);
+    if (idx == t->cap) {
+        int cap = t->cap ? 2 * t->cap : 64;
+        t->offset = arena_realloc(g->mem, t->offset, (size_t)t->cap * sizeof(size_t),
+                                  (size_t)cap * sizeof(size_t));
+        t->cap = cap;
+    }
+    if (t->pool_len + len + 1 > t->pool_cap) {
+        size_t cap = t->pool_cap ? t->pool_cap : 4096;
+        while (t->pool_len + len + 1 > cap) cap *= 2;
+        t->pool = arena_realloc(g->mem, t->pool, t->pool_cap, cap);
+        t->pool_cap = cap;
+    }
+    memcpy(t->pool + t->pool_len, name, len);
+    t->pool[t->pool_len + len] = '\0';
+    t->offset[idx] = t->pool_len;
+    t->pool_len   += len + 1;
+
+    unsigned int slot = find_slot(g, name, len, h);
+    t->slots[slot].hash = h;
+    t->slots[slot].idx  = idx;
 
-    g->adj[idx] = NULL;
     g->n_vertices++;
+    g->versao++;
     return idx;
 }
 
 /**
  * Retorna o índice de um vértice pelo nome, adicionando-o se necessário.
  * @param g grafo onde o vértice será adicionado
- * @param name nome do vértice a ser adicionado
+ * @param name nome do vértice a ser adicionado (não precisa terminar em '\0')
+ * @param len tamanho do nome
+ * @param h hash de name
  * @return índice do vértice
  */
-static int get_vertex_index(struct grafo *g, const char *name) {
-    int idx = find_vertex_index(g, name);
-    if (idx < 0) {
-        idx = add_vertex(g, name);
+static int get_vertex_index(struct grafo *g, const char *name, size_t len, unsigned int h) {
+    if (g->names.n_slots) {
+        int idx = g->names.slots[find_slot(g, name, len, h)].idx;
+        if (idx >= 0) return idx;
     }
-    return idx;
+    return add_vertex(g, name, len, h);
 }
 
 /**
@@ -89,535 +564,4402 @@ static int get_vertex_index(struct grafo *g, const char *name) {
  * @param weight  peso da aresta
  */
 static void add_edge(struct grafo *g, int u, int v, int weight) {
-    // u → v
-    adj_node *node = malloc(sizeof(adj_node));
-    if (!node) exit(EXIT_FAILURE);
-    node->v      = v;
-    node->weight = weight;
-    node->next   = g->adj[u];
-    g->adj[u]    = node;
-    // v → u
-    node = malloc(sizeof(adj_node));
-    if (!node) exit(EXIT_FAILURE);
-    node->v      = u;
-    node->weight = weight;
-    node->next   = g->adj[v];
-    g->adj[v]    = node;
-
+    if (g->n_edges == g->edges_cap) {
+        int cap = g->edges_cap ? 2 * g->edges_cap : 256;
+        g->edges = arena_realloc(g->mem, g->edges, (size_t)g->edges_cap * sizeof(edge_rec),
+                                 (size_t)cap * sizeof(edge_rec));
+        g->edges_cap = cap;
+    }
+    edge_rec *e = &g->edges[g->n_edges++];
     g->n_arestas++;
+    e->u      = u;
+    e->v      = v;
+    e->weight = weight;
+    g->versao++;
 }
 
-struct grafo *le_grafo(FILE *f) {
-    char buffer[4096];
-    struct grafo *g = malloc(sizeof(struct grafo));
-    if (!g) return NULL;
-    g->name       = NULL;
-    g->n_vertices = 0;
-    g->n_arestas  = 0;
-    g->vertices   = NULL;
-    g->adj        = NULL;
+//------------------------------------------------------------------------------
+// Adjacência comprimida
+//
+// Com define_compressao(1), build_csr deixa a lista de vizinhos de cada
+// vértice em ordem crescente e a guarda em adj_z, a partir de adj_zoff[u],
+// como diferenças em varint: 7 bits por byte, com o bit alto indicando que o
+// número continua no byte seguinte. O primeiro vizinho é a diferença para o
+// próprio u em zigue-zague (0, -1, 1, -2, ... viram 0, 1, 2, 3, ...), os
+// demais a diferença para o anterior. adj fica NULL; adj_off continua dando
+// o grau de cada vértice e a posição de seus pesos em adj_w.
+//
+// Os núcleos percorrem os vizinhos com nbr_begin/nbr_next, que leem adj ou
+// decodificam adj_z, de modo que o mesmo código serve às duas formas.
 
-    int have_name = 0;
-    while (fgets(buffer, sizeof(buffer), f)) {
-        buffer[strcspn(buffer, "\n")] = '\0';
-        char *line = trim(buffer);
-        if (line[0] == '\0' || (line[0] == '/' && line[1] == '/')) {
-            continue;
-        }
-        if (!have_name) {
-            // Primeira linha não-comentário é o nome do grafo
-            g->name = malloc(strlen(line) + 1);
-            if (!g->name) exit(EXIT_FAILURE);
-            strcpy(g->name, line);
-            have_name = 1;
-            continue;
-        }
-        // Verifica se é linha de aresta (contém "--")
-        char *d = strstr(line, "--");
-        if (d) {
-            // separar "v1 -- v2 [peso]"
-            *d = '\0';
-            char *v1 = trim(line);
-            char *right = trim(d + 2);
-            // right tem "v2 [peso]" ou só "v2"
-            char vname2[256];
-            int weight = 1;  // peso padrão = 1
-            char *tok = strtok(right, " \t");
-            if (tok) {
-                strcpy(vname2, tok);
-                char *tok2 = strtok(NULL, " \t");
-                if (tok2) {
-                    weight = atoi(tok2);
-                }
-            } else {
-                continue; // linha malformada → ignora
-            }
-            int i1 = get_vertex_index(g, v1);
-            int i2 = get_vertex_index(g, vname2);
-            add_edge(g, i1, i2, weight);
-        } else {
-            // Linha de vértice isolado
-            char *v = line;
-            if (find_vertex_index(g, v) < 0) {
-                add_vertex(g, v);
-            }
-        }
-    }
-    return g;
+// Compressão pedida por define_compressao
+static unsigned int compress_config;
+
+void define_compressao(unsigned int ativa) {
+    compress_config = ativa ? 1 : 0;
 }
 
-unsigned int destroi_grafo(struct grafo *g) {
-    if (!g) return 0;
-    for (int i = 0; i < g->n_vertices; i++) {
-        adj_node *p = g->adj[i];
-        while (p) {
-            adj_node *tmp = p;
-            p = p->next;
-            free(tmp);
-        }
-        free(g->vertices[i]);
-    }
-    free(g->vertices);
-    free(g->adj);
-    free(g->name);
-    free(g);
-    return 1;
+/**
+ * Posição na lista de vizinhos de um vértice.
+ */
+typedef struct nbr_iter {
+    const int *adj;               // adj sem compressão, ou NULL
+    const unsigned char *z;       // próximo byte de adj_z
+    unsigned int e, start, end;   // próxima meia-aresta, início e fim da faixa
+    int v;                        // vizinho corrente (antes do primeiro, o vértice)
+} nbr_iter;
+
+static inline void nbr_begin(const struct grafo *g, int u, nbr_iter *it) {
+    it->e   = it->start = g->adj_off[u];
+    it->end = g->adj_off[u + 1];
+    it->adj = g->adj;
+    it->z   = g->adj ? NULL : g->adj_z + g->adj_zoff[u];
+    it->v   = u;
 }
 
-char *nome(struct grafo *g) {
-    if (!g) return NULL;
-    return g->name;
+/**
+ * Avança para o próximo vizinho, que fica em it->v; o índice da meia-aresta
+ * (para adj_w) é it->e - 1.
+ * @return 0 se os vizinhos acabaram
+ */
+static inline int nbr_next(nbr_iter *it) {
+    if (it->e == it->end) return 0;
+    if (it->adj) {
+        it->v = it->adj[it->e++];
+        return 1;
+    }
+    const unsigned char *z = it->z;
+    unsigned int x = *z++;
+    if (x & 0x80u) {
+        unsigned int b, shift = 7;
+        x &= 0x7fu;
+        do {
+            b = *z++;
+            x |= (b & 0x7fu) << shift;
+            shift += 7;
+        } while (b & 0x80u);
+    }
+    it->z = z;
+    if (it->e++ == it->start)
+        it->v += (int)(x >> 1) ^ -(int)(x & 1u);
+    else
+        it->v += (int)x;
+    return 1;
 }
 
-unsigned int n_vertices(struct grafo *g) {
-    if (!g) return 0;
-    return g->n_vertices;
+static unsigned int zigzag(int d) {
+    return d < 0 ? 2u * (unsigned int)(-(d + 1)) + 1u : 2u * (unsigned int)d;
 }
 
+static size_t varint_len(unsigned int x) {
+    size_t len = 1;
+    for (; x >= 0x80u; x >>= 7) len++;
+    return len;
+}
 
-unsigned int n_arestas(struct grafo *g) {
-    if (!g) return 0;
-    return g->n_arestas;
+static unsigned char *varint_put(unsigned char *p, unsigned int x) {
+    for (; x >= 0x80u; x >>= 7) *p++ = (unsigned char)(x | 0x80u);
+    *p++ = (unsigned char)x;
+    return p;
 }
 
 /**
- * Realiza uma busca em profundidade (DFS) para marcar todos os vértices
- * alcançados a partir de um vértice inicial.
- * @param g grafo a ser percorrido
- * @param u vértice inicial
- * @param visited vetor de controle de visitados
+ * Ordena e comprime a adjacência off/adj/adj_w (fora da arena, liberada
+ * aqui) e a instala em g. As faixas saem ordenadas de uma transposição:
+ * percorrendo os vértices x em ordem e pondo x na faixa de cada vizinho, cada
+ * faixa recebe seus vizinhos em ordem crescente, já que cada aresta aparece
+ * nos dois extremos.
  */
-static void dfs_comp(struct grafo *g, int u, int *visited) {
-    visited[u] = 1;
-    adj_node *p = g->adj[u];
-    while (p) {
-        int v = p->v;
-        if (!visited[v]) dfs_comp(g, v, visited);
-        p = p->next;
+static void compress_csr(struct grafo *g, unsigned int *off, int *adj, int *adj_w) {
+    int n = g->n_vertices;
+    size_t total = off[n];
+    int *sorted = malloc(total * sizeof(int) + 1);
+    int *sorted_w = adj_w ? arena_alloc(g->mem, total * sizeof(int)) : NULL;
+    unsigned int *pos = malloc(((size_t)n + 1) * sizeof(unsigned int));
+    if (!sorted || !pos) exit(EXIT_FAILURE);
+    memcpy(pos, off, ((size_t)n + 1) * sizeof(unsigned int));
+    for (int x = 0; x < n; x++) {
+        for (unsigned int e = off[x]; e < off[x + 1]; e++) {
+            unsigned int p = pos[adj[e]]++;
+            sorted[p] = x;
+            if (adj_w) sorted_w[p] = adj_w[e];
+        }
     }
-}
+    free(pos);
+    free(adj);
+    free(adj_w);
 
-unsigned int n_componentes(struct grafo *g) {
-    if (!g) return 0;
-    int n = g->n_vertices;
-    int *visited = calloc(n, sizeof(int));
-    if (!visited) exit(EXIT_FAILURE);
-    int count = 0;
-    for (int i = 0; i < n; i++) {
-        if (!visited[i]) {
-            count++;
-            dfs_comp(g, i, visited);
+    size_t *zoff = arena_alloc(g->mem, ((size_t)n + 1) * sizeof(size_t));
+    size_t len = 0;
+    for (int u = 0; u < n; u++) {
+        zoff[u] = len;
+        int prev = u;
+        for (unsigned int e = off[u]; e < off[u + 1]; e++) {
+            len += varint_len(e == off[u] ? zigzag(sorted[e] - prev)
+                                          : (unsigned int)(sorted[e] - prev));
+            prev = sorted[e];
         }
     }
-    free(visited);
-    return count;
+    zoff[n] = len;
+    unsigned char *z = arena_alloc(g->mem, len);
+    for (int u = 0; u < n; u++) {
+        unsigned char *q = z + zoff[u];
+        int prev = u;
+        for (unsigned int e = off[u]; e < off[u + 1]; e++) {
+            q = varint_put(q, e == off[u] ? zigzag(sorted[e] - prev)
+                                          : (unsigned int)(sorted[e] - prev));
+            prev = sorted[e];
+        }
+    }
+    free(sorted);
+    g->adj      = NULL;
+    g->adj_w    = sorted_w;
+    g->adj_z    = z;
+    g->adj_zoff = zoff;
 }
 
 /**
- * Realiza uma busca em profundidade (DFS) para verificar se o grafo é bipartido.
- * @param g  grafo a ser analisado
- * @param u  vértice atual
- * @param color  vetor de cores (-1 = não visitado, 0 = cor 1, 1 = cor 2)
- * @return  1 se g é bipartido, 0 caso contrário
- */
-static int dfs_bipartite(struct grafo *g, int u, int *color) {
-    adj_node *p = g->adj[u];
-    while (p) {
-        int v = p->v;
-        if (color[v] == -1) {
-            color[v] = 1 - color[u];
-            if (!dfs_bipartite(g, v, color)) return 0;
-        } else if (color[v] == color[u]) {
-            return 0;
-        }
-        p = p->next;
+ * Devolve à arena a adjacência montada (adj_off, adj ou adj_z, adj_w).
+ */
+static void release_csr(struct grafo *g) {
+    if (!g->adj_off) return;
+    size_t n = (size_t)g->n_csr, total = g->adj_off[n];
+    arena_release(g->mem, g->adj, total * sizeof(int));
+    arena_release(g->mem, g->adj_w, total * sizeof(int));
+    if (g->adj_z) {
+        arena_release(g->mem, g->adj_z, g->adj_zoff[n]);
+        arena_release(g->mem, g->adj_zoff, (n + 1) * sizeof(size_t));
     }
-    return 1;
+    arena_release(g->mem, g->adj_off, (n + 1) * sizeof(unsigned int));
+    g->adj_off  = NULL;
+    g->adj      = NULL;
+    g->adj_w    = NULL;
+    g->adj_z    = NULL;
+    g->adj_zoff = NULL;
 }
 
-unsigned int bipartido(struct grafo *g) {
-    if (!g) return 0;
-    int n = g->n_vertices;
-    int *color = malloc(n * sizeof(int));
-    if (!color) exit(EXIT_FAILURE);
-    for (int i = 0; i < n; i++) color[i] = -1;
-    for (int i = 0; i < n; i++) {
-        if (color[i] == -1) {
-            color[i] = 0;
-            if (!dfs_bipartite(g, i, color)) {
-                free(color);
-                return 0;
-            }
-        }
+/**
+ * Troca a adjacência comprimida pela forma sem compressão, que pode ser
+ * modificada no lugar.
+ */
+static void expand_csr(struct grafo *g) {
+    if (!g->adj_z) return;
+    size_t n = (size_t)g->n_csr, total = g->adj_off[n];
+    int *adj = arena_alloc(g->mem, total * sizeof(int));
+    nbr_iter it;
+    for (int u = 0; u < g->n_csr; u++) {
+        for (nbr_begin(g, u, &it); nbr_next(&it); ) adj[it.e - 1] = it.v;
     }
-    free(color);
-    return 1;
+    arena_release(g->mem, g->adj_z, g->adj_zoff[n]);
+    arena_release(g->mem, g->adj_zoff, (n + 1) * sizeof(size_t));
+    g->adj      = adj;
+    g->adj_z    = NULL;
+    g->adj_zoff = NULL;
 }
 
-static const int INF = INT_MAX / 2;
-
 /**
- * Calcula as distâncias mínimas de um vértice de origem para todos os outros vértices
- * @param g  grafo a ser analisado
- * @param src  índice do vértice de origem
- * @return  um vetor de distâncias do vértice src para todos os outros vértices
+ * Monta a adjacência em formato CSR a partir da adjacência atual e das
+ * arestas pendentes em g->edges, que são liberadas em seguida. Cada aresta
+ * {u, v} aparece como v na faixa de u e como u na faixa de v; as entradas
+ * removidas (marcadas com -1) são descartadas e as demais mantêm a ordem,
+ * seguidas das arestas novas na ordem em que foram adicionadas. Com
+ * compressão, as faixas são então ordenadas e comprimidas. Os pesos só são
+ * guardados se algum for diferente de 1.
+ * @param g grafo a ser finalizado
  */
-static int *dijkstra(struct grafo *g, int src) {
-    int n = g->n_vertices;
-    int *dist    = malloc(n * sizeof(int));
-    int *visited = calloc(n, sizeof(int));
-    if (!dist || !visited) exit(EXIT_FAILURE);
-    for (int i = 0; i < n; i++) dist[i] = INF;
-    dist[src] = 0;
-    for (int _ = 0; _ < n; _++) {
-        int u = -1, min = INF;
-        for (int j = 0; j < n; j++) {
-            if (!visited[j] && dist[j] < min) {
-                min = dist[j];
-                u = j;
-            }
+static void build_csr(struct grafo *g) {
+    int n = g->n_vertices, old_n = g->n_csr;
+    int compress = compress_config != 0;
+    unsigned int *off = arena_alloc(g->mem, ((size_t)n + 1) * sizeof(unsigned int));
+    unsigned int *pos = malloc(((size_t)n + 1) * sizeof(unsigned int));
+    if (!pos) exit(EXIT_FAILURE);
+    memset(off, 0, ((size_t)n + 1) * sizeof(unsigned int));
+    int unit = 1;
+    nbr_iter it;
+    for (int u = 0; u < old_n; u++) {
+        for (nbr_begin(g, u, &it); nbr_next(&it); ) {
+            if (it.v < 0) continue;
+            off[u + 1]++;
+            if (g->adj_w) unit &= g->adj_w[it.e - 1] == 1;
         }
-        if (u < 0) break;
-        visited[u] = 1;
-        adj_node *p = g->adj[u];
-        while (p) {
-            int v = p->v;
-            int w = p->weight;
-            if (dist[u] + w < dist[v]) {
-                dist[v] = dist[u] + w;
-            }
-            p = p->next;
+    }
+    for (int i = 0; i < g->n_edges; i++) {
+        off[g->edges[i].u + 1]++;
+        off[g->edges[i].v + 1]++;
+        unit &= g->edges[i].weight == 1;
+    }
+    for (int i = 0; i < n; i++) off[i + 1] += off[i];
+    memcpy(pos, off, ((size_t)n + 1) * sizeof(unsigned int));
+
+    // Com compressão, a forma plana é só um passo intermediário
+    size_t total = off[n];
+    int *adj, *adj_w = NULL;
+    if (compress) {
+        adj = malloc(total * sizeof(int) + 1);
+        if (!unit) adj_w = malloc(total * sizeof(int) + 1);
+        if (!adj || (!unit && !adj_w)) exit(EXIT_FAILURE);
+    } else {
+        adj = arena_alloc(g->mem, total * sizeof(int));
+        if (!unit) adj_w = arena_alloc(g->mem, total * sizeof(int));
+    }
+    for (int u = 0; u < old_n; u++) {
+        for (nbr_begin(g, u, &it); nbr_next(&it); ) {
+            if (it.v < 0) continue;
+            unsigned int p = pos[u]++;
+            adj[p] = it.v;
+            if (adj_w) adj_w[p] = g->adj_w ? g->adj_w[it.e - 1] : 1;
         }
     }
-    free(visited);
-    return dist;
+    for (int i = 0; i < g->n_edges; i++) {
+        edge_rec *e = &g->edges[i];
+        unsigned int p = pos[e->u]++;
+        adj[p] = e->v;
+        if (adj_w) adj_w[p] = e->weight;
+        p = pos[e->v]++;
+        adj[p] = e->u;
+        if (adj_w) adj_w[p] = e->weight;
+    }
+    free(pos);
+    release_csr(g);
+    arena_release(g->mem, g->edges, (size_t)g->edges_cap * sizeof(edge_rec));
+    g->edges     = NULL;
+    g->edges_cap = 0;
+    g->n_edges   = 0;
+    g->n_removed = 0;
+    g->n_csr     = n;
+    g->unit_weights = unit;
+    g->adj_off   = off;
+    if (compress) {
+        compress_csr(g, off, adj, adj_w);
+    } else {
+        g->adj   = adj;
+        g->adj_w = adj_w;
+    }
 }
 
-char *diametros(struct grafo *g) {
-    if (!g) return NULL;
-    int n = g->n_vertices;
-    int *visited = calloc(n, sizeof(int));
-    if (!visited) exit(EXIT_FAILURE);
-
-    // Máximo de um componente por vértice
-    int *diam = malloc(n * sizeof(int));
-    if (!diam) exit(EXIT_FAILURE);
-    int comp_count = 0;
+/**
+ * Remonta o CSR se o grafo mudou desde a última montagem. Toda rotina que
+ * percorre adj_off/adj deve passar por aqui (em geral, via analysis).
+ * @param g grafo
+ */
+static void sync_csr(struct grafo *g) {
+    if (g->n_edges || g->n_removed || g->n_csr != g->n_vertices) build_csr(g);
+}
 
-    for (int i = 0; i < n; i++) {
-        if (!visited[i]) {
-            // Descobre todos os vértices desse componente
-            int *stack   = malloc(n * sizeof(int));
-            int  top     = 0;
-            visited[i]   = 1;
-            stack[top++] = i;
-            int comp_size = 0;
-            int *members  = malloc(n * sizeof(int));
-            members[comp_size++] = i;
-
-            while (top) {
-                int u = stack[--top];
-                adj_node *p = g->adj[u];
-                while (p) {
-                    int v = p->v;
-                    if (!visited[v]) {
-                        visited[v] = 1;
-                        stack[top++]    = v;
-                        members[comp_size++] = v;
-                    }
-                    p = p->next;
-                }
-            }
-            // Calcular o diâmetro deste componente
-            int maxdist = 0;
-            for (int j = 0; j < comp_size; j++) {
-                int u = members[j];
-                int *dist = dijkstra(g, u);
-                for (int k = 0; k < comp_size; k++) {
-                    int v = members[k];
-                    if (dist[v] < INF && dist[v] > maxdist) {
-                        maxdist = dist[v];
-                    }
-                }
-                free(dist);
-            }
-            diam[comp_count++] = maxdist;
-            free(stack);
-            free(members);
-        }
+/**
+ * Informa se todas as arestas de g têm peso 1, caso em que as distâncias
+ * saem de buscas em largura. build_csr registra isso ao montar o CSR; uma
+ * imagem binária é verificada na primeira consulta.
+ * @param g grafo com o CSR em dia
+ */
+static int has_unit_weights(struct grafo *g) {
+    if (g->unit_weights < 0) {
+        unsigned int total = g->adj_off[g->n_vertices];
+        int unit = 1;
+        for (unsigned int e = 0; e < total && unit; e++) unit = g->adj_w[e] == 1;
+        g->unit_weights = unit;
     }
-    free(visited);
+    return g->unit_weights;
+}
 
-    // Ordena diametros em ordem não decrescente
-    for (int i = 0; i < comp_count - 1; i++) {
-        for (int j = i + 1; j < comp_count; j++) {
-            if (diam[i] > diam[j]) {
-                int tmp = diam[i];
-                diam[i] = diam[j];
-                diam[j] = tmp;
-            }
-        }
+/**
+ * Copia para a arena tudo o que aponta para a imagem binária mapeada e
+ * desfaz o mapeamento, para que o grafo possa ser modificado.
+ * @param g grafo
+ */
+static void detach_mapping(struct grafo *g) {
+    if (!g->map_base) return;
+    name_table *t = &g->names;
+    size_t n = (size_t)g->n_vertices;
+    size_t half = g->adj_off[n];
+    void *copy[7] = { g->name, t->pool, t->offset, t->slots, g->adj_off, g->adj, g->adj_w };
+    size_t len[7] = {
+        g->name ? strlen(g->name) + 1 : 0, t->pool_len, n * sizeof(size_t),
+        t->n_slots * sizeof(name_slot), (n + 1) * sizeof(unsigned int),
+        half * sizeof(int), half * sizeof(int)
+    };
+    for (int i = 0; i < 7; i++) {
+        if (!copy[i]) continue;
+        void *p = arena_alloc(g->mem, len[i]);
+        memcpy(p, copy[i], len[i]);
+        copy[i] = p;
     }
+    g->name      = copy[0];
+    t->pool      = copy[1];
+    t->offset    = copy[2];
+    t->slots     = copy[3];
+    g->adj_off   = copy[4];
+    g->adj       = copy[5];
+    g->adj_w     = copy[6];
+    t->pool_cap  = t->pool_len;
+    t->cap       = g->n_vertices;
+    munmap(g->map_base, g->map_size);
+    g->map_base = NULL;
+    g->map_size = 0;
+}
+
+//------------------------------------------------------------------------------
+// Renumeração dos vértices
+//
+// A leitura numera os vértices na ordem em que aparecem na entrada, que em
+// geral nada tem a ver com a estrutura do grafo: vizinhos ficam longe uns dos
+// outros nos vetores indexados por vértice (disc, low, dist, ...) e cada passo
+// de uma busca toca uma linha de cache diferente. Com define_reordenacao,
+// le_grafo e le_grafo_arquivo renumeram os vértices logo depois de montar o
+// CSR. Os nomes acompanham os vértices, então as consultas, que escrevem
+// nomes ou contagens, não mudam; só indice_vertice e nome_vertice veem a
+// nova numeração.
 
-    // Monta a string de saída
-    int bufsize = comp_count * 12 + 1;
-    char *res = malloc(bufsize);
-    if (!res) exit(EXIT_FAILURE);
-    res[0] = '\0';
+// Ordem pedida por define_reordenacao
+static unsigned int reorder_config = REORDENACAO_NENHUMA;
 
-    char temp[32];
-    for (int i = 0; i < comp_count; i++) {
-        if (i > 0) strcat(res, " ");
-        snprintf(temp, sizeof(temp), "%d", diam[i]);
-        strcat(res, temp);
-    }
-    free(diam);
-    return res;
+void define_reordenacao(unsigned int ordem) {
+    reorder_config = ordem;
 }
 
-//------------------------------------------------------------------------------
-// Articulation points (vértices de corte)
-static int time_dfs_ap;
+static unsigned int csr_degree(const struct grafo *g, int v) {
+    return g->adj_off[v + 1] - g->adj_off[v];
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
 
 /**
- * Realiza uma busca em profundidade (DFS) para encontrar pontos de articulação no grafo.
- * @param g  grafo a ser analisado
- * @param u  vértice atual
- * @param visited  vetor de controle de visitados
- * @param disc  vetor de descoberta (tempo de visita)
- * @param low  vetor de menor descoberta alcançada
- * @param parent  vetor de pais na DFS
- * @param ap  vetor de pontos de articulação (1 se é ponto de articulação, 0 caso contrário)
- */
-static void ap_dfs(struct grafo *g, int u, int *visited, int *disc, int *low, int *parent, int *ap) {
-    visited[u] = 1;
-    disc[u] = low[u] = ++time_dfs_ap;
-    int children = 0;
-
-    adj_node *p = g->adj[u];
-    while (p) {
-        int v = p->v;
-        if (!visited[v]) {
-            children++;
-            parent[v] = u;
-            ap_dfs(g, v, visited, disc, low, parent, ap);
-            // atualiza low[u]
-            low[u] = (low[u] < low[v]) ? low[u] : low[v];
-            // u é raiz e tem 2 ou mais filhos
-            if (parent[u] == -1 && children > 1) {
-                ap[u] = 1;
-            }
-            // u não é raiz e low[v] >= disc[u]
-            if (parent[u] != -1 && low[v] >= disc[u]) {
-                ap[u] = 1;
-            }
-        } else if (v != parent[u]) {
-            // v é um back-edge
-            low[u] = (low[u] < disc[v]) ? low[u] : disc[v];
-        }
-        p = p->next;
+ * Põe os vértices em ordem de grau por contagem; no empate, em ordem de
+ * índice.
+ * @param order recebe os n vértices
+ * @param descending 1 para grau decrescente
+ * @return maior grau
+ */
+static unsigned int order_by_degree(const struct grafo *g, int *order, int descending) {
+    int n = g->n_vertices;
+    unsigned int max_deg = 0;
+    for (int v = 0; v < n; v++) {
+        if (csr_degree(g, v) > max_deg) max_deg = csr_degree(g, v);
     }
+    unsigned int *start = calloc((size_t)max_deg + 2, sizeof(unsigned int));
+    if (!start) exit(EXIT_FAILURE);
+    for (int v = 0; v < n; v++) {
+        unsigned int d = csr_degree(g, v);
+        start[(descending ? max_deg - d : d) + 1]++;
+    }
+    for (unsigned int d = 0; d <= max_deg; d++) start[d + 1] += start[d];
+    for (int v = 0; v < n; v++) {
+        unsigned int d = csr_degree(g, v);
+        order[start[descending ? max_deg - d : d]++] = v;
+    }
+    free(start);
+    return max_deg;
 }
 
-char *vertices_corte(struct grafo *g) {
-    if (!g) return NULL;
+/**
+ * Ordem de Cuthill–McKee reversa: em cada componente, uma busca em largura a
+ * partir do vértice de menor grau, que visita os vizinhos novos de cada
+ * vértice em ordem crescente de grau; a ordem de visita, invertida, é a nova
+ * numeração. Vértices próximos no grafo ganham números próximos.
+ * @param order recebe order[k] = vértice que passa a ter o número k
+ */
+static void rcm_order(const struct grafo *g, int *order) {
     int n = g->n_vertices;
-    int *visited = calloc(n, sizeof(int));
-    int *disc    = malloc(n * sizeof(int));
-    int *low     = malloc(n * sizeof(int));
-    int *parent  = malloc(n * sizeof(int));
-    int *ap      = calloc(n, sizeof(int));
-    if (!visited || !disc || !low || !parent || !ap) exit(EXIT_FAILURE);
+    int *roots = malloc(((size_t)n + 1) * sizeof(int));
+    unsigned char *seen = calloc((size_t)n + 1, 1);
+    if (!roots || !seen) exit(EXIT_FAILURE);
+    unsigned int max_deg = order_by_degree(g, roots, 0);
+    uint64_t *keys = malloc(((size_t)max_deg + 1) * sizeof(uint64_t));
+    if (!keys) exit(EXIT_FAILURE);
 
+    // As raízes em ordem crescente de grau: a primeira de cada componente é a
+    // de menor grau nele
+    int len = 0;
+    nbr_iter it;
     for (int i = 0; i < n; i++) {
-        parent[i]  = -1;
-        visited[i] = 0;
-        ap[i]      = 0;
-    }
-    time_dfs_ap = 0;
-    for (int i = 0; i < n; i++) {
-        if (!visited[i]) {
-            ap_dfs(g, i, visited, disc, low, parent, ap);
+        int r = roots[i];
+        if (seen[r]) continue;
+        seen[r] = 1;
+        order[len++] = r;
+        for (int head = len - 1; head < len; head++) {
+            int first = len;
+            for (nbr_begin(g, order[head], &it); nbr_next(&it); ) {
+                if (seen[it.v]) continue;
+                seen[it.v] = 1;
+                order[len++] = it.v;
+            }
+            if (len - first < 2) continue;
+            size_t k = (size_t)(len - first);
+            for (size_t j = 0; j < k; j++) {
+                int v = order[first + (int)j];
+                keys[j] = (uint64_t)csr_degree(g, v) << 32 | (uint32_t)v;
+            }
+            qsort(keys, k, sizeof(uint64_t), cmp_u64);
+            for (size_t j = 0; j < k; j++) order[first + (int)j] = (int)(keys[j] & 0xffffffffu);
         }
     }
-    // Conta quantos vértices de corte existem
-    int count = 0;
-    for (int i = 0; i < n; i++) {
-        if (ap[i]) count++;
+    for (int i = 0, j = n - 1; i < j; i++, j--) {
+        int t = order[i];
+        order[i] = order[j];
+        order[j] = t;
     }
-    if (count == 0) {
-        free(visited); free(disc); free(low); free(parent); free(ap);
-        char *res = malloc(1);
-        res[0] = '\0';
-        return res;
+    free(keys);
+    free(seen);
+    free(roots);
+}
+
+/**
+ * Dá ao vértice order[k] o número k: permuta os nomes, reindexa a tabela
+ * hash e remonta a adjacência (comprimida, se já estava) com os novos
+ * números. Deve ser chamada com o CSR em dia e sem análises guardadas.
+ */
+static void renumber(struct grafo *g, const int *order) {
+    int n = g->n_vertices;
+    name_table *t = &g->names;
+    int *id = malloc(((size_t)n + 1) * sizeof(int));
+    if (!id) exit(EXIT_FAILURE);
+    for (int k = 0; k < n; k++) id[order[k]] = k;
+
+    size_t *offset = arena_alloc(g->mem, (size_t)t->cap * sizeof(size_t));
+    for (int k = 0; k < n; k++) offset[k] = t->offset[order[k]];
+    arena_release(g->mem, t->offset, (size_t)t->cap * sizeof(size_t));
+    t->offset = offset;
+    for (unsigned int i = 0; i < t->n_slots; i++) {
+        if (t->slots[i].idx >= 0) t->slots[i].idx = id[t->slots[i].idx];
     }
-    // Coleta nomes e ordena
-    char **names = malloc(count * sizeof(char *));
-    int idx = 0;
-    for (int i = 0; i < n; i++) {
-        if (ap[i]) {
-            names[idx++] = g->vertices[i];
-        }
+
+    // A faixa de order[k] passa a ser a de k, com os vizinhos renumerados
+    int compress = g->adj_z != NULL, unit = g->unit_weights;
+    unsigned int *off = arena_alloc(g->mem, ((size_t)n + 1) * sizeof(unsigned int));
+    off[0] = 0;
+    for (int k = 0; k < n; k++) off[k + 1] = off[k] + csr_degree(g, order[k]);
+    size_t total = off[n];
+    int *adj, *adj_w = NULL;
+    if (compress) {
+        adj = malloc(total * sizeof(int) + 1);
+        if (g->adj_w) adj_w = malloc(total * sizeof(int) + 1);
+        if (!adj || (g->adj_w && !adj_w)) exit(EXIT_FAILURE);
+    } else {
+        adj = arena_alloc(g->mem, total * sizeof(int));
+        if (g->adj_w) adj_w = arena_alloc(g->mem, total * sizeof(int));
     }
-    for (int i = 0; i < count - 1; i++) {
-        for (int j = i + 1; j < count; j++) {
-            if (strcmp(names[i], names[j]) > 0) {
-                char *tmp = names[i];
-                names[i] = names[j];
-                names[j] = tmp;
-            }
+    nbr_iter it;
+    for (int k = 0; k < n; k++) {
+        unsigned int p = off[k];
+        for (nbr_begin(g, order[k], &it); nbr_next(&it); p++) {
+            adj[p] = id[it.v];
+            if (adj_w) adj_w[p] = g->adj_w[it.e - 1];
         }
     }
-    // Construir string
-    int length = 0;
-    for (int i = 0; i < count; i++) {
-        length += strlen(names[i]) + 1;
-    }
-    char *res = malloc(length + 1);
-    if (!res) exit(EXIT_FAILURE);
-    res[0] = '\0';
-    for (int i = 0; i < count; i++) {
-        if (i > 0) strcat(res, " ");
-        strcat(res, names[i]);
+    free(id);
+    release_csr(g);
+    g->adj_off = off;
+    g->unit_weights = unit;
+    if (compress) {
+        compress_csr(g, off, adj, adj_w);
+    } else {
+        g->adj   = adj;
+        g->adj_w = adj_w;
     }
-    free(names);
-    free(visited); free(disc); free(low); free(parent); free(ap);
-    return res;
+    g->versao++;
 }
 
 /**
- *  Estrutura para armazenar pares de arestas (u, v) onde u < v
- *  representa uma aresta de corte.
+ * Renumera os vértices de um grafo recém-lido na ordem de define_reordenacao.
+ */
+static void reorder_vertices(struct grafo *g) {
+    unsigned int ordem = reorder_config;
+    if ((ordem != REORDENACAO_RCM && ordem != REORDENACAO_GRAU) || g->n_vertices < 2) return;
+    int *order = malloc((size_t)g->n_vertices * sizeof(int));
+    if (!order) exit(EXIT_FAILURE);
+    if (ordem == REORDENACAO_RCM) rcm_order(g, order);
+    else order_by_degree(g, order, 1);
+    renumber(g, order);
+    free(order);
+}
+
+//------------------------------------------------------------------------------
+// Leitura do formato texto
+
+/**
+ * Classificação de uma linha da entrada.
+ */
+enum line_kind {
+    LINE_EMPTY,           // linha vazia ou comentário
+    LINE_VERTEX,          // declaração de vértice (sem "--")
+    LINE_EDGE,            // aresta "v1 -- v2 [peso]"
+    LINE_BAD              // contém "--" mas não tem o segundo vértice
+};
+
+/**
+ * Resultado da análise de uma linha. Os campos apontam para dentro da
+ * própria linha, que não é modificada.
+ */
+typedef struct line_tok {
+    enum line_kind kind;
+    const char *text;     // linha sem espaços nas extremidades
+    size_t text_len;
+    const char *a;        // primeiro vértice (ou o vértice isolado)
+    size_t a_len;
+    const char *b;        // segundo vértice
+    size_t b_len;
+    int weight;
+} line_tok;
+
+/**
+ * Remove espaços em branco no início e no final de um trecho de texto.
+ * @param s início do trecho, atualizado para o primeiro caractere não branco
+ * @param len tamanho do trecho, atualizado para o tamanho sem os brancos
+ */
+static void trim_span(const char **s, size_t *len) {
+    const char *p = *s;
+    size_t n = *len;
+    while (n && isspace((unsigned char)*p)) { p++; n--; }
+    while (n && isspace((unsigned char)p[n - 1])) n--;
+    *s = p;
+    *len = n;
+}
+
+/**
+ * Converte o início de um token em inteiro com a mesma semântica de atoi.
+ * @param s início do token
+ * @param len tamanho do token
+ * @return valor lido (0 se o token não começa com um número)
+ */
+static int span_atoi(const char *s, size_t len) {
+    size_t i = 0;
+    int neg = 0;
+    long val = 0;
+    while (i < len && isspace((unsigned char)s[i])) i++;
+    if (i < len && (s[i] == '+' || s[i] == '-')) neg = s[i++] == '-';
+    while (i < len && s[i] >= '0' && s[i] <= '9') {
+        val = val * 10 + (s[i++] - '0');
+        if (val > INT_MAX) val = INT_MAX;
+    }
+    return (int)(neg ? -val : val);
+}
+
+/**
+ * Analisa uma linha da entrada sem copiá-la nem modificá-la.
+ * Linhas vazias e comentários ("//") são LINE_EMPTY; linhas com "--" são
+ * arestas, com o segundo vértice e o peso separados por espaço ou tab;
+ * as demais declaram um vértice.
+ * @param s início da linha (sem o '\n')
+ * @param len tamanho da linha
+ * @param t estrutura preenchida com o resultado
+ */
+static void parse_line(const char *s, size_t len, line_tok *t) {
+    trim_span(&s, &len);
+    t->text     = s;
+    t->text_len = len;
+    if (len == 0 || (len >= 2 && s[0] == '/' && s[1] == '/')) {
+        t->kind = LINE_EMPTY;
+        return;
+    }
+    const char *d = NULL;
+    for (size_t i = 0; i + 1 < len; i++) {
+        if (s[i] == '-' && s[i + 1] == '-') {
+            d = s + i;
+            break;
+        }
+    }
+    if (!d) {
+        t->kind  = LINE_VERTEX;
+        t->a     = s;
+        t->a_len = len;
+        return;
+    }
+    // separar "v1 -- v2 [peso]"
+    t->a     = s;
+    t->a_len = (size_t)(d - s);
+    trim_span(&t->a, &t->a_len);
+    const char *r = d + 2;
+    size_t r_len = len - (size_t)(r - s);
+    trim_span(&r, &r_len);
+
+    // r tem "v2 [peso]" ou só "v2"
+    const char *end = r + r_len;
+    while (r < end && (*r == ' ' || *r == '\t')) r++;
+    if (r == end) {
+        t->kind = LINE_BAD; // linha malformada → ignora
+        return;
+    }
+    const char *q = r;
+    while (q < end && *q != ' ' && *q != '\t') q++;
+    t->kind   = LINE_EDGE;
+    t->b      = r;
+    t->b_len  = (size_t)(q - r);
+    t->weight = 1;  // peso padrão = 1
+    while (q < end && (*q == ' ' || *q == '\t')) q++;
+    if (q < end) {
+        const char *w = q;
+        while (q < end && *q != ' ' && *q != '\t') q++;
+        t->weight = span_atoi(w, (size_t)(q - w));
+    }
+}
+
+/**
+ * Aloca um grafo vazio, com sua arena.
+ * @return grafo criado
+ */
+static struct grafo *new_graph(void) {
+    struct arena *mem = arena_create();
+    struct grafo *g = arena_alloc(mem, sizeof(struct grafo));
+    memset(g, 0, sizeof(struct grafo));
+    g->mem = mem;
+    return g;
+}
+
+/**
+ * Guarda o nome do grafo.
+ * @param g grafo
+ * @param s nome (não precisa terminar em '\0')
+ * @param len tamanho do nome
+ */
+static void set_graph_name(struct grafo *g, const char *s, size_t len) {
+    g->name = arena_alloc(g->mem, len + 1);
+    memcpy(g->name, s, len);
+    g->name[len] = '\0';
+}
+
+/**
+ * Aplica ao grafo uma linha já analisada (vértice ou aresta).
+ * @param g grafo
+ * @param t linha analisada
+ */
+static void apply_line(struct grafo *g, const line_tok *t) {
+    if (t->kind == LINE_EDGE) {
+        int i1 = get_vertex_index(g, t->a, t->a_len, hash_name(t->a, t->a_len));
+        int i2 = get_vertex_index(g, t->b, t->b_len, hash_name(t->b, t->b_len));
+        add_edge(g, i1, i2, t->weight);
+    } else if (t->kind == LINE_VERTEX) {
+        // Linha de vértice isolado
+        get_vertex_index(g, t->a, t->a_len, hash_name(t->a, t->a_len));
+    }
+}
+
+/**
+ * Lê as linhas do texto de um grafo, guarda o nome (primeira linha
+ * não-comentário) e passa cada linha seguinte para apply.
+ * @param f arquivo de onde o grafo será lido
+ * @param g grafo
+ * @param apply função que incorpora uma linha ao grafo
+ */
+static void read_text(FILE *f, struct grafo *g,
+                      void (*apply)(struct grafo *, const line_tok *)) {
+    // getline lê a linha inteira, qualquer que seja o tamanho, como o
+    // leitor de le_grafo_arquivo
+    char *buffer = NULL;
+    size_t cap = 0;
+    ssize_t n;
+    int have_name = 0;
+    while ((n = getline(&buffer, &cap, f)) > 0) {
+        size_t len = (size_t)n;
+        if (buffer[len - 1] == '\n') len--;
+        line_tok t;
+        parse_line(buffer, len, &t);
+        if (t.kind == LINE_EMPTY) {
+            continue;
+        }
+        if (!have_name) {
+            // Primeira linha não-comentário é o nome do grafo
+            set_graph_name(g, t.text, t.text_len);
+            have_name = 1;
+            continue;
+        }
+        apply(g, &t);
+    }
+    free(buffer);
+}
+
+struct grafo *le_grafo(FILE *f) {
+    struct sonda p;
+    probe_begin(NULL, &p, FASE_LE_GRAFO);
+    struct grafo *g = new_graph();
+    read_text(f, g, apply_line);
+    build_csr(g);
+    reorder_vertices(g);
+    probe_loaded(g, &p);
+    return g;
+}
+
+//------------------------------------------------------------------------------
+// Execução paralela
+
+// Número de threads fixado por define_threads (0 = automático)
+static unsigned int threads_config;
+
+void define_threads(unsigned int n) {
+    threads_config = n;
+}
+
+/**
+ * Número de threads usado pelos algoritmos paralelos: o valor fixado por
+ * define_threads ou, se não houver, a variável de ambiente GRAFO_THREADS
+ * ou o número de processadores disponíveis.
+ */
+static unsigned int n_threads(void) {
+    long n = threads_config;
+    if (n == 0) {
+        const char *env = getenv("GRAFO_THREADS");
+        n = env ? strtol(env, NULL, 10) : sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (n < 1) n = 1;
+    if (n > 256) n = 256;
+    return (unsigned int)n;
+}
+
+typedef struct par_task {
+    void (*fn)(void *arg, unsigned int tid);
+    void *arg;
+    unsigned int tid;
+    struct sonda *probe;  // sonda de quem chamou run_parallel
+} par_task;
+
+static void *par_entry(void *p) {
+    par_task *t = p;
+    probe_current = t->probe;
+    t->fn(t->arg, t->tid);
+    return NULL;
+}
+
+/**
+ * Executa fn(arg, tid) para tid = 0 .. nthreads - 1, cada chamada em uma
+ * thread (a de tid 0 na thread que chamou), e espera todas terminarem.
+ * @param nthreads número de threads
+ * @param fn função a executar
+ * @param arg argumento repassado a fn
+ */
+static void run_parallel(unsigned int nthreads, void (*fn)(void *, unsigned int), void *arg) {
+    if (nthreads <= 1) {
+        fn(arg, 0);
+        return;
+    }
+    pthread_t *th = malloc(nthreads * sizeof(pthread_t));
+    par_task *tasks = malloc(nthreads * sizeof(par_task));
+    if (!th || !tasks) exit(EXIT_FAILURE);
+    for (unsigned int i = 0; i < nthreads; i++) {
+        tasks[i].fn  = fn;
+        tasks[i].arg = arg;
+        tasks[i].tid = i;
+        tasks[i].probe = probe_current;
+    }
+    for (unsigned int i = 1; i < nthreads; i++) {
+        if (pthread_create(&th[i], NULL, par_entry, &tasks[i]) != 0) exit(EXIT_FAILURE);
+    }
+    fn(arg, 0);
+    for (unsigned int i = 1; i < nthreads; i++) pthread_join(th[i], NULL);
+    free(th);
+    free(tasks);
+}
+
+//------------------------------------------------------------------------------
+// Leitura paralela de arquivos mapeados em memória
+//
+// O arquivo é mapeado com mmap e, depois da linha com o nome do grafo,
+// dividido em trechos que terminam em fim de linha. Cada thread analisa o seu
+// trecho e numera os nomes que encontra na ordem da primeira ocorrência, sem
+// copiá-los. Os nomes são então incorporados à tabela global trecho a trecho,
+// em ordem, o que reproduz exatamente a numeração de le_grafo.
+
+// Arquivos menores que isso por thread são lidos por menos threads
+#define PARSE_MIN_CHUNK ((size_t)1 << 20)
+
+/**
+ * Nome encontrado por uma thread: aponta para dentro do arquivo mapeado.
+ */
+typedef struct chunk_name {
+    const char *s;
+    size_t len;
+    unsigned int hash;
+} chunk_name;
+
+/**
+ * Trecho do arquivo analisado por uma thread e seus resultados.
+ */
+typedef struct parse_chunk {
+    const char *begin;
+    const char *end;
+    chunk_name *names;    // nomes na ordem da primeira ocorrência no trecho
+    int n_names;
+    int names_cap;
+    name_slot *slots;     // tabela hash local: nome -> índice em names
+    unsigned int n_slots;
+    edge_rec *edges;      // arestas com índices locais
+    int n_edges;
+    int edges_cap;
+    int *map;             // índice local -> índice global
+    int edge_base;        // posição da primeira aresta do trecho em g->edges
+} parse_chunk;
+
+/**
+ * Devolve o índice local do nome no trecho, registrando-o se for novo.
+ */
+static int chunk_intern(parse_chunk *c, const char *s, size_t len) {
+    unsigned int h = hash_name(s, len);
+    if (2 * ((unsigned int)c->n_names + 1) > c->n_slots) {
+        unsigned int n = c->n_slots ? 2 * c->n_slots : 1024;
+        name_slot *slots = malloc(n * sizeof(name_slot));
+        if (!slots) exit(EXIT_FAILURE);
+        for (unsigned int i = 0; i < n; i++) slots[i].idx = -1;
+        for (unsigned int i = 0; i < c->n_slots; i++) {
+            if (c->slots[i].idx < 0) continue;
+            unsigned int j = c->slots[i].hash & (n - 1);
+            while (slots[j].idx >= 0) j = (j + 1) & (n - 1);
+            slots[j] = c->slots[i];
+        }
+        free(c->slots);
+        c->slots   = slots;
+        c->n_slots = n;
+    }
+    unsigned int mask = c->n_slots - 1;
+    unsigned int i = h & mask;
+    while (c->slots[i].idx >= 0) {
+        chunk_name *cn = &c->names[c->slots[i].idx];
+        if (cn->hash == h && cn->len == len && memcmp(cn->s, s, len) == 0) {
+            return c->slots[i].idx;
+        }
+        i = (i + 1) & mask;
+    }
+    if (c->n_names == c->names_cap) {
+        c->names_cap = c->names_cap ? 2 * c->names_cap : 1024;
+        c->names = realloc(c->names, (size_t)c->names_cap * sizeof(chunk_name));
+        if (!c->names) exit(EXIT_FAILURE);
+    }
+    c->names[c->n_names].s    = s;
+    c->names[c->n_names].len  = len;
+    c->names[c->n_names].hash = h;
+    c->slots[i].hash = h;
+    c->slots[i].idx  = c->n_names;
+    return c->n_names++;
+}
+
+/**
+ * Analisa as linhas de um trecho (executada em paralelo, uma por trecho).
+ */
+static void parse_chunk_lines(void *arg, unsigned int tid) {
+    parse_chunk *c = (parse_chunk *)arg + tid;
+    const char *p = c->begin;
+    while (p < c->end) {
+        const char *nl = memchr(p, '\n', (size_t)(c->end - p));
+        const char *eol = nl ? nl : c->end;
+        line_tok t;
+        parse_line(p, (size_t)(eol - p), &t);
+        p = nl ? nl + 1 : c->end;
+        if (t.kind == LINE_EDGE) {
+            int u = chunk_intern(c, t.a, t.a_len);
+            int v = chunk_intern(c, t.b, t.b_len);
+            if (c->n_edges == c->edges_cap) {
+                c->edges_cap = c->edges_cap ? 2 * c->edges_cap : 4096;
+                c->edges = realloc(c->edges, (size_t)c->edges_cap * sizeof(edge_rec));
+                if (!c->edges) exit(EXIT_FAILURE);
+            }
+            edge_rec *e = &c->edges[c->n_edges++];
+            e->u      = u;
+            e->v      = v;
+            e->weight = t.weight;
+        } else if (t.kind == LINE_VERTEX) {
+            chunk_intern(c, t.a, t.a_len);
+        }
+    }
+}
+
+/**
+ * Estado compartilhado pela cópia paralela das arestas.
+ */
+typedef struct remap_job {
+    struct grafo *g;
+    parse_chunk *chunks;
+} remap_job;
+
+/**
+ * Copia as arestas de um trecho para o grafo, já com índices globais
+ * (executada em paralelo, uma por trecho).
+ */
+static void remap_edges(void *arg, unsigned int tid) {
+    remap_job *job = arg;
+    parse_chunk *c = &job->chunks[tid];
+    edge_rec *dst = job->g->edges + c->edge_base;
+    for (int i = 0; i < c->n_edges; i++) {
+        dst[i].u      = c->map[c->edges[i].u];
+        dst[i].v      = c->map[c->edges[i].v];
+        dst[i].weight = c->edges[i].weight;
+    }
+}
+
+static struct grafo *read_text_file(const char *caminho) {
+    if (!caminho) return NULL;
+    int fd = open(caminho, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return NULL;
+    }
+    size_t size = (size_t)st.st_size;
+    const char *data = NULL;
+    if (size > 0) {
+        void *m = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (m == MAP_FAILED) {
+            close(fd);
+            return NULL;
+        }
+        data = m;
+        posix_madvise(m, size, POSIX_MADV_SEQUENTIAL);
+    }
+    close(fd);
+
+    struct grafo *g = new_graph();
+    const char *p = data, *end = data + size;
+
+    // Primeira linha não-comentário é o nome do grafo
+    while (p < end) {
+        const char *nl = memchr(p, '\n', (size_t)(end - p));
+        const char *eol = nl ? nl : end;
+        line_tok t;
+        parse_line(p, (size_t)(eol - p), &t);
+        p = nl ? nl + 1 : end;
+        if (t.kind != LINE_EMPTY) {
+            set_graph_name(g, t.text, t.text_len);
+            break;
+        }
+    }
+
+    // Divide o restante em trechos terminados em fim de linha
+    unsigned int nthreads = n_threads();
+    size_t rest = (size_t)(end - p);
+    if (rest / PARSE_MIN_CHUNK < nthreads) nthreads = (unsigned int)(rest / PARSE_MIN_CHUNK);
+    if (nthreads < 1) nthreads = 1;
+    parse_chunk *chunks = calloc(nthreads, sizeof(parse_chunk));
+    if (!chunks) exit(EXIT_FAILURE);
+    const char *cur = p;
+    for (unsigned int i = 0; i < nthreads; i++) {
+        const char *stop = (i + 1 == nthreads) ? end : p + rest / nthreads * (i + 1);
+        if (stop < cur) stop = cur;
+        if (stop < end) {
+            const char *nl = memchr(stop, '\n', (size_t)(end - stop));
+            stop = nl ? nl + 1 : end;
+        }
+        chunks[i].begin = cur;
+        chunks[i].end   = stop;
+        cur = stop;
+    }
+    run_parallel(nthreads, parse_chunk_lines, chunks);
+
+    // Incorpora os nomes em ordem, trecho a trecho
+    int total_edges = 0;
+    for (unsigned int i = 0; i < nthreads; i++) {
+        parse_chunk *c = &chunks[i];
+        c->map = malloc(((size_t)c->n_names + 1) * sizeof(int));
+        if (!c->map) exit(EXIT_FAILURE);
+        for (int j = 0; j < c->n_names; j++) {
+            c->map[j] = get_vertex_index(g, c->names[j].s, c->names[j].len, c->names[j].hash);
+        }
+        c->edge_base = total_edges;
+        total_edges += c->n_edges;
+    }
+    g->edges_cap = total_edges;
+    g->n_edges   = total_edges;
+    g->n_arestas = total_edges;
+    g->edges = arena_alloc(g->mem, (size_t)total_edges * sizeof(edge_rec));
+    remap_job job = { g, chunks };
+    run_parallel(nthreads, remap_edges, &job);
+
+    for (unsigned int i = 0; i < nthreads; i++) {
+        free(chunks[i].names);
+        free(chunks[i].slots);
+        free(chunks[i].edges);
+        free(chunks[i].map);
+    }
+    free(chunks);
+    if (size > 0) munmap((void *)(uintptr_t)data, size);
+
+    build_csr(g);
+    reorder_vertices(g);
+    return g;
+}
+
+struct grafo *le_grafo_arquivo(const char *caminho) {
+    struct sonda p;
+    probe_begin(NULL, &p, FASE_LE_GRAFO_ARQUIVO);
+    struct grafo *g = read_text_file(caminho);
+    probe_loaded(g, &p);
+    return g;
+}
+
+//------------------------------------------------------------------------------
+// Imagem binária do grafo
+//
+// Layout do arquivo: um cabeçalho de tamanho fixo seguido das seções, cada
+// uma começando em deslocamento múltiplo de BIN_ALIGN:
+//   nome do grafo ('\0' final), pool de nomes, offset dos nomes (size_t),
+//   tabela hash de nomes, adj_off, adj e adj_w.
+// As seções têm exatamente o formato das estruturas em memória, de modo que
+// carrega_grafo_binario só precisa mapear o arquivo e apontar para elas.
+
+#define BIN_MAGIC   "GRAFOBIN"
+#define BIN_VERSION 1u
+#define BIN_ENDIAN  0x01020304u
+#define BIN_ALIGN   ((size_t)16)
+
+/**
+ * Cabeçalho da imagem binária.
+ */
+typedef struct bin_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t endian;          // BIN_ENDIAN na ordem de bytes de quem gravou
+    uint32_t word_size;       // sizeof(size_t) de quem gravou
+    uint32_t n_vertices;
+    uint32_t n_arestas;
+    uint32_t n_slots;
+    uint64_t name_len;        // inclui o '\0'
+    uint64_t pool_len;
+    uint64_t payload_size;    // bytes após o cabeçalho
+    uint64_t payload_sum;     // checksum das seções
+    uint64_t header_sum;      // checksum dos campos anteriores
+} bin_header;
+
+/**
+ * Checksum incremental: FNV-1a sobre palavras de 64 bits, com os bytes que
+ * não completam uma palavra guardados para a próxima chamada.
+ */
+typedef struct checksum {
+    uint64_t h;
+    unsigned char carry[8];
+    size_t n_carry;
+} checksum;
+
+static void checksum_init(checksum *c) {
+    c->h = 14695981039346656037ull;
+    c->n_carry = 0;
+}
+
+static void checksum_word(checksum *c, uint64_t w) {
+    c->h ^= w;
+    c->h *= 1099511628211ull;
+    c->h ^= c->h >> 29;
+}
+
+static void checksum_update(checksum *c, const void *data, size_t len) {
+    const unsigned char *p = data;
+    while (len && c->n_carry) {
+        c->carry[c->n_carry++] = *p++;
+        len--;
+        if (c->n_carry == 8) {
+            uint64_t w;
+            memcpy(&w, c->carry, 8);
+            checksum_word(c, w);
+            c->n_carry = 0;
+        }
+    }
+    for (; len >= 8; p += 8, len -= 8) {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        checksum_word(c, w);
+    }
+    while (len--) c->carry[c->n_carry++] = *p++;
+}
+
+static uint64_t checksum_final(checksum *c) {
+    if (c->n_carry) {
+        uint64_t w = 0;
+        memcpy(&w, c->carry, c->n_carry);
+        checksum_word(c, w ^ ((uint64_t)c->n_carry << 56));
+        c->n_carry = 0;
+    }
+    return c->h;
+}
+
+static uint64_t header_checksum(const bin_header *h) {
+    checksum c;
+    checksum_init(&c);
+    checksum_update(&c, h, offsetof(bin_header, header_sum));
+    return checksum_final(&c);
+}
+
+static size_t bin_pad(size_t len) {
+    return (BIN_ALIGN - len % BIN_ALIGN) % BIN_ALIGN;
+}
+
+/**
+ * Grava uma seção seguida do preenchimento até BIN_ALIGN, atualizando o
+ * checksum e o tamanho total das seções.
+ * @return 1 em caso de sucesso, 0 em caso de erro de escrita
+ */
+static int bin_write_section(FILE *f, checksum *c, uint64_t *total, const void *data, size_t len) {
+    static const char zeros[16] = { 0 };
+    size_t pad = bin_pad(len);
+    if (len && fwrite(data, 1, len, f) != len) return 0;
+    if (pad && fwrite(zeros, 1, pad, f) != pad) return 0;
+    checksum_update(c, data, len);
+    checksum_update(c, zeros, pad);
+    *total += len + pad;
+    return 1;
+}
+
+/**
+ * Tamanhos das seções da imagem, na ordem em que aparecem no arquivo.
+ */
+static void bin_sections(const bin_header *h, size_t len[7]) {
+    size_t half = 2 * (size_t)h->n_arestas;
+    len[0] = (size_t)h->name_len;
+    len[1] = (size_t)h->pool_len;
+    len[2] = (size_t)h->n_vertices * sizeof(size_t);
+    len[3] = (size_t)h->n_slots * sizeof(name_slot);
+    len[4] = ((size_t)h->n_vertices + 1) * sizeof(unsigned int);
+    len[5] = half * sizeof(int);
+    len[6] = half * sizeof(int);
+}
+
+static unsigned int write_snapshot(struct grafo *g, const char *caminho) {
+    sync_csr(g);
+    FILE *f = fopen(caminho, "wb");
+    if (!f) return 0;
+
+    bin_header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, BIN_MAGIC, 8);
+    h.version    = BIN_VERSION;
+    h.endian     = BIN_ENDIAN;
+    h.word_size  = (uint32_t)sizeof(size_t);
+    h.n_vertices = (uint32_t)g->n_vertices;
+    h.n_arestas  = (uint32_t)g->n_arestas;
+    h.n_slots    = g->names.n_slots;
+    h.name_len   = g->name ? strlen(g->name) + 1 : 0;
+    h.pool_len   = g->names.pool_len;
+
+    // A imagem tem sempre adj e adj_w completos, como a forma em memória
+    // sem compressão
+    size_t half = g->adj_off[g->n_vertices];
+    int *adj = g->adj, *adj_w = g->adj_w;
+    if (!adj) {
+        adj = malloc(half * sizeof(int) + 1);
+        if (!adj) exit(EXIT_FAILURE);
+        nbr_iter it;
+        for (int u = 0; u < g->n_vertices; u++) {
+            for (nbr_begin(g, u, &it); nbr_next(&it); ) adj[it.e - 1] = it.v;
+        }
+    }
+    if (!adj_w) {
+        adj_w = malloc(half * sizeof(int) + 1);
+        if (!adj_w) exit(EXIT_FAILURE);
+        for (size_t e = 0; e < half; e++) adj_w[e] = 1;
+    }
+    const void *data[7] = {
+        g->name, g->names.pool, g->names.offset, g->names.slots,
+        g->adj_off, adj, adj_w
+    };
+    size_t len[7];
+    bin_sections(&h, len);
+
+    checksum c;
+    checksum_init(&c);
+    int ok = fwrite(&h, sizeof(h), 1, f) == 1;
+    for (int i = 0; ok && i < 7; i++) {
+        ok = bin_write_section(f, &c, &h.payload_size, data[i], len[i]);
+    }
+    if (ok) {
+        // Regrava o cabeçalho, agora com tamanho e checksums
+        h.payload_sum = checksum_final(&c);
+        h.header_sum  = header_checksum(&h);
+        ok = fseek(f, 0, SEEK_SET) == 0 && fwrite(&h, sizeof(h), 1, f) == 1;
+    }
+    if (adj != g->adj) free(adj);
+    if (adj_w != g->adj_w) free(adj_w);
+    if (fclose(f) != 0) ok = 0;
+    if (!ok) remove(caminho);
+    return ok ? 1 : 0;
+}
+
+unsigned int salva_grafo_binario(struct grafo *g, const char *caminho) {
+    if (!g || g->streamed || !caminho) return 0;
+    struct sonda p;
+    probe_begin(g, &p, FASE_SALVA_BINARIO);
+    unsigned int ok = write_snapshot(g, caminho);
+    probe_end(g, &p);
+    return ok;
+}
+
+/**
+ * Confere a estrutura das seções de uma imagem, para que um arquivo
+ * corrompido ou forjado não leve as consultas a ler fora das seções nem a
+ * procurar um nome para sempre. As verificações de custo O(n) são sempre
+ * feitas; com verifica, também o checksum e os extremos de todas as arestas.
+ * @return 1 se a imagem é consistente, 0 caso contrário
+ */
+static int snapshot_consistent(const bin_header *h, void *const sec[7], unsigned int verifica) {
+    size_t n = h->n_vertices, half = 2 * (size_t)h->n_arestas;
+    const char *name = sec[0], *pool = sec[1];
+    const size_t *offset = sec[2];
+    const name_slot *slots = sec[3];
+    const unsigned int *adj_off = sec[4];
+    const int *adj = sec[5];
+    if (n > INT_MAX || half > UINT_MAX) return 0;
+    // Um nome ausente só para a sondagem em uma posição livre
+    if (h->n_slots == 0 ? n != 0 : h->n_slots / 2 < n) return 0;
+    if (h->name_len && name[h->name_len - 1] != '\0') return 0;
+    if (h->pool_len && pool[h->pool_len - 1] != '\0') return 0;
+    for (size_t i = 0; i < n; i++) {
+        if (offset[i] >= h->pool_len) return 0;
+    }
+    size_t used = 0;
+    for (size_t i = 0; i < h->n_slots; i++) {
+        if (slots[i].idx >= (int)n) return 0;
+        if (slots[i].idx >= 0) used++;
+    }
+    if (used != n) return 0;
+    if (adj_off[0] != 0 || adj_off[n] != half) return 0;
+    for (size_t i = 0; i < n; i++) {
+        if (adj_off[i] > adj_off[i + 1]) return 0;
+    }
+    if (!verifica) return 1;
+    checksum c;
+    checksum_init(&c);
+    checksum_update(&c, sec[0], h->payload_size);
+    if (checksum_final(&c) != h->payload_sum) return 0;
+    for (size_t i = 0; i < half; i++) {
+        if (adj[i] < 0 || (size_t)adj[i] >= n) return 0;
+    }
+    return 1;
+}
+
+static struct grafo *map_snapshot(const char *caminho, unsigned int verifica) {
+    if (!caminho) return NULL;
+    int fd = open(caminho, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(bin_header)) {
+        close(fd);
+        return NULL;
+    }
+    size_t size = (size_t)st.st_size;
+    void *m = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (m == MAP_FAILED) return NULL;
+
+    const bin_header *h = m;
+    size_t len[7];
+    bin_sections(h, len);
+    size_t payload = 0;
+    for (int i = 0; i < 7; i++) payload += len[i] + bin_pad(len[i]);
+    if (memcmp(h->magic, BIN_MAGIC, 8) != 0 || h->version != BIN_VERSION ||
+        h->endian != BIN_ENDIAN || h->word_size != sizeof(size_t) ||
+        h->header_sum != header_checksum(h) || h->name_len > size || h->pool_len > size ||
+        h->payload_size != payload || sizeof(bin_header) + payload != size ||
+        (h->n_slots & (h->n_slots - 1)) != 0) {
+        munmap(m, size);
+        return NULL;
+    }
+
+    // As estruturas apontam diretamente para o arquivo mapeado
+    const char *p = (const char *)m + sizeof(bin_header);
+    void *sec[7];
+    for (int i = 0; i < 7; i++) {
+        sec[i] = (void *)(uintptr_t)p;
+        p += len[i] + bin_pad(len[i]);
+    }
+    if (!snapshot_consistent(h, sec, verifica)) {
+        munmap(m, size);
+        return NULL;
+    }
+    struct grafo *g = new_graph();
+    g->map_base       = m;
+    g->map_size       = size;
+    g->name           = h->name_len ? sec[0] : NULL;
+    g->n_vertices     = (int)h->n_vertices;
+    g->n_arestas      = (int)h->n_arestas;
+    g->names.pool     = sec[1];
+    g->names.pool_len = (size_t)h->pool_len;
+    g->names.pool_cap = (size_t)h->pool_len;
+    g->names.offset   = sec[2];
+    g->names.cap      = g->n_vertices;
+    g->names.slots    = sec[3];
+    g->names.n_slots  = h->n_slots;
+    g->adj_off        = sec[4];
+    g->adj            = sec[5];
+    g->adj_w          = sec[6];
+    g->n_csr          = g->n_vertices;
+    g->unit_weights   = -1;
+    return g;
+}
+
+struct grafo *carrega_grafo_binario(const char *caminho, unsigned int verifica) {
+    struct sonda p;
+    probe_begin(NULL, &p, FASE_CARREGA_BINARIO);
+    struct grafo *g = map_snapshot(caminho, verifica);
+    probe_loaded(g, &p);
+    return g;
+}
+
+unsigned int memoria_grafo(struct grafo *g, struct grafo_memoria *m) {
+    if (!g || !m) return 0;
+    m->reservado = g->mem->reserved;
+    m->usado     = g->mem->used;
+    m->blocos    = g->mem->n_blocks;
+    m->alocacoes = g->mem->n_allocs;
+    return 1;
+}
+
+int indice_vertice(struct grafo *g, const char *nome) {
+    if (!g || !nome) return -1;
+    struct sonda p;
+    probe_begin(g, &p, FASE_INDICE_VERTICE);
+    int i = find_vertex_index(g, nome);
+    probe_end(g, &p);
+    return i;
+}
+
+const char *nome_vertice(struct grafo *g, int i) {
+    if (!g || i < 0 || i >= g->n_vertices) return NULL;
+    return vertex_name(g, i);
+}
+
+unsigned long buscas_diametros(struct grafo *g) {
+    if (!g) return 0;
+    return g->n_buscas;
+}
+
+char *nome(struct grafo *g) {
+    if (!g) return NULL;
+    return g->name;
+}
+
+unsigned int n_vertices(struct grafo *g) {
+    if (!g) return 0;
+    return g->n_vertices;
+}
+
+
+unsigned int n_arestas(struct grafo *g) {
+    if (!g) return 0;
+    return g->n_arestas;
+}
+
+//------------------------------------------------------------------------------
+// Análise compartilhada
+
+/**
+ * Resultados de análise do grafo, calculados sob demanda e guardados na arena
+ * do grafo para que as consultas não repitam o mesmo percurso. Cada parte tem
+ * sua marca de validade; a análise inteira é descartada quando o grafo muda
+ * (g->versao deixa de coincidir com versao).
+ */
+struct analise {
+    unsigned long versao; // versão do grafo analisada
+    int n;                // número de vértices na análise
+    unsigned char has_comp, has_dfs, has_color, has_diam, has_tri, has_alt;
+
+    // Componentes
+    int n_comp;
+    int *comp;            // componente de cada vértice
+    int *members;         // vértices agrupados por componente
+    int *comp_start;      // início de cada componente em members (n_comp + 1)
+
+    // Biconectividade; disc, low e parent só na busca em profundidade
+    int *disc;            // ordem de descoberta, a partir de 1
+    int *low;
+    int *parent;          // pai na árvore da busca ou -1
+    unsigned char *ap;    // ap[v] = 1 se v é vértice de corte
+    int n_ap;
+    int *bridges;         // pontes: pares (u, v) de índices de vértices
+    int n_bridges, bridges_cap;
+    int n_blocks;         // componentes biconexas (blocos) com ao menos uma aresta
+
+    // Bipartição
+    unsigned char *color; // 2-coloração (paridade da profundidade na busca);
+                          // só tem sentido se bipartite
+    int bipartite;
+
+    // Diâmetros
+    int *diam;            // diâmetro de cada componente, em ordem não decrescente
+    unsigned int diam_strategy;
+
+    // Triângulos e coeficiente de agrupamento
+    unsigned long long n_triangles;
+    double *clustering;   // agrupamento local de cada vértice
+    double global_clustering;
+    double mean_clustering;
+
+    // Índice de marcos (has_alt) e área de trabalho de distancia
+    int n_landmarks;
+    int *landmarks;       // vértices escolhidos como marcos
+    int *lm_dist;         // lm_dist[v * n_landmarks + i]: distância do marco i a v
+    int alt_guided;       // os marcos guiam as consultas (calibrate_landmarks)
+    struct alt_ws **alt_pool; // áreas de trabalho livres de distancia
+    int alt_n, alt_cap;
+    pthread_mutex_t alt_lock; // trava de alt_pool
+};
+
+#define AN_COMP  1u
+#define AN_DFS   2u
+#define AN_COLOR 4u
+#define AN_TRI   8u
+
+/**
+ * Devolve à arena os vetores da análise e destrói sua trava; quem a reusa
+ * inicia a trava de novo (veja analysis).
+ */
+static void drop_analysis(struct grafo *g, struct analise *a) {
+    size_t vn = ((size_t)a->n + 1) * sizeof(int);
+    arena_release(g->mem, a->comp, vn);
+    arena_release(g->mem, a->members, vn);
+    arena_release(g->mem, a->comp_start, vn);
+    arena_release(g->mem, a->disc, vn);
+    arena_release(g->mem, a->low, vn);
+    arena_release(g->mem, a->parent, vn);
+    arena_release(g->mem, a->ap, (size_t)a->n + 1);
+    arena_release(g->mem, a->bridges, 2 * (size_t)a->bridges_cap * sizeof(int));
+    arena_release(g->mem, a->color, (size_t)a->n + 1);
+    arena_release(g->mem, a->diam, (size_t)a->n_comp * sizeof(int));
+    arena_release(g->mem, a->clustering, ((size_t)a->n + 1) * sizeof(double));
+    arena_release(g->mem, a->landmarks, ((size_t)a->n_landmarks + 1) * sizeof(int));
+    arena_release(g->mem, a->lm_dist, ((size_t)a->n * (size_t)a->n_landmarks + 1) * sizeof(int));
+    for (int i = 0; i < a->alt_n; i++) free(a->alt_pool[i]);
+    free(a->alt_pool);
+    pthread_mutex_destroy(&a->alt_lock);
+    memset(a, 0, sizeof(*a));
+}
+
+unsigned int destroi_grafo(struct grafo *g) {
+    if (!g) return 0;
+    struct sonda p;
+    probe_begin(NULL, &p, FASE_DESTROI);
+    // As áreas de trabalho de distancia ficam fora da arena
+    if (g->cache) drop_analysis(g, g->cache);
+    if (g->map_base) munmap(g->map_base, g->map_size);
+    // O próprio grafo mora na arena
+    arena_destroy(g->mem);
+    probe_end(NULL, &p);
+    return 1;
+}
+
+/**
+ * Percorre o grafo uma única vez em profundidade (Tarjan), com pilha
+ * explícita, e preenche componentes, dados de low-link, vértices de corte,
+ * pontes, blocos e a bipartição. Arestas paralelas e laços não formam
+ * ciclos: só a aresta da árvore da busca é considerada entre um vértice e
+ * seu pai. Cada vértice recebe a paridade de sua profundidade na árvore; o
+ * grafo é bipartido se nenhuma aresta liga vértices de mesma paridade.
+ */
+static void analysis_dfs(struct grafo *g, struct analise *a) {
+    int n = g->n_vertices;
+    size_t vn = ((size_t)n + 1) * sizeof(int);
+    // Posição na lista de vizinhos de cada vértice da pilha
+    int *stack = malloc(vn);
+    nbr_iter *it = malloc(((size_t)n + 1) * sizeof(nbr_iter));
+    if (!stack || !it) exit(EXIT_FAILURE);
+
+    int *disc = a->disc = arena_alloc(g->mem, vn);
+    int *low = a->low = arena_alloc(g->mem, vn);
+    int *parent = a->parent = arena_alloc(g->mem, vn);
+    if (!a->comp) {
+        a->comp       = arena_alloc(g->mem, vn);
+        a->members    = arena_alloc(g->mem, vn);
+        a->comp_start = arena_alloc(g->mem, vn);
+    }
+    a->ap    = arena_alloc(g->mem, (size_t)n + 1);
+    if (!a->color) a->color = arena_alloc(g->mem, (size_t)n + 1);
+    memset(disc, 0, vn);   // 0 = não visitado
+    memset(a->ap, 0, (size_t)n + 1);
+    a->n_ap = a->n_bridges = a->n_blocks = 0;
+    a->bipartite = 1;
+
+    int time = 0, n_comp = 0, n_members = 0;
+    for (int r = 0; r < n; r++) {
+        if (disc[r]) continue;
+        int top = 0, root_children = 0;
+        a->comp_start[n_comp] = n_members;
+        a->members[n_members++] = r;
+        a->comp[r] = n_comp;
+        a->color[r] = 0;
+        disc[r] = low[r] = ++time;
+        parent[r] = -1;
+        nbr_begin(g, r, &it[top]);
+        stack[top++] = r;
+        while (top) {
+            int u = stack[top - 1];
+            if (nbr_next(&it[top - 1])) {
+                int v = it[top - 1].v;
+                if (!disc[v]) {
+                    if (u == r) root_children++;
+                    parent[v] = u;
+                    disc[v] = low[v] = ++time;
+                    a->comp[v]  = n_comp;
+                    a->color[v] = a->color[u] ^ 1;
+                    a->members[n_members++] = v;
+                    nbr_begin(g, v, &it[top]);
+                    stack[top++] = v;
+                } else {
+                    if (a->color[v] == a->color[u]) a->bipartite = 0;
+                    if (v != parent[u] && disc[v] < low[u]) {
+                        // v é um back-edge
+                        low[u] = disc[v];
+                    }
+                }
+                continue;
+            }
+            // u terminou: propaga low para o pai e testa a aresta (p, u)
+            top--;
+            int p = parent[u];
+            if (p < 0) continue;
+            if (low[u] < low[p]) low[p] = low[u];
+            if (low[u] >= disc[p]) {
+                a->n_blocks++;
+                if (p != r && !a->ap[p]) {
+                    a->ap[p] = 1;
+                    a->n_ap++;
+                }
+            }
+            if (low[u] > disc[p]) {
+                if (a->n_bridges == a->bridges_cap) {
+                    int cap = a->bridges_cap ? 2 * a->bridges_cap : 64;
+                    a->bridges = arena_realloc(g->mem, a->bridges,
+                                               2 * (size_t)a->bridges_cap * sizeof(int),
+                                               2 * (size_t)cap * sizeof(int));
+                    a->bridges_cap = cap;
+                }
+                a->bridges[2 * a->n_bridges]     = p;
+                a->bridges[2 * a->n_bridges + 1] = u;
+                a->n_bridges++;
+            }
+        }
+        // A raiz é vértice de corte se tem 2 ou mais filhos
+        if (root_children > 1) {
+            a->ap[r] = 1;
+            a->n_ap++;
+        }
+        n_comp++;
+    }
+    a->comp_start[n_comp] = n_members;
+    a->n_comp = n_comp;
+    a->has_comp = a->has_dfs = a->has_color = 1;
+    probe_count((unsigned long long)n, g->adj_off[n], 0, 0);
+    free(stack);
+    free(it);
+}
+
+//------------------------------------------------------------------------------
+// Componentes em paralelo
+//
+// Quando só os componentes são pedidos, em grafos grandes, eles saem de
+// conjuntos disjuntos concorrentes em vez da busca em profundidade: cada
+// thread percorre um bloco de vértices e une os extremos de cada aresta.
+// A união liga sempre a raiz de maior índice à de menor, com compare-and-swap,
+// de modo que a raiz de cada conjunto é o menor vértice do componente e os
+// componentes, numerados na ordem de suas raízes, recebem os mesmos números
+// que a busca em profundidade lhes daria.
+
+// Grafos com menos vértices que isso têm os componentes calculados pela busca
+// em profundidade
+#define CC_PAR_MIN 65536
+
+// Vértices pegos de uma vez por uma thread
+#define CC_BLOCK 4096
+
+/**
+ * Estado compartilhado pelo cálculo paralelo dos componentes.
+ */
+typedef struct cc_job {
+    struct grafo *g;
+    int *parent;          // floresta dos conjuntos; depois, raiz de cada vértice
+    int next;             // próximo vértice a ser distribuído
+    int pass;             // 0: une as arestas; 1: liga cada vértice à raiz
+} cc_job;
+
+/**
+ * Raiz do conjunto de x, com divisão do caminho pela metade. Várias threads
+ * podem escrever o mesmo parent[x]; qualquer valor escrito é um ancestral de
+ * x, o que mantém a floresta válida.
+ */
+static int cc_find(int *parent, int x) {
+    for (;;) {
+        int p  = __atomic_load_n(&parent[x], __ATOMIC_RELAXED);
+        int gp = __atomic_load_n(&parent[p], __ATOMIC_RELAXED);
+        if (p == gp) return p;
+        __atomic_store_n(&parent[x], gp, __ATOMIC_RELAXED);
+        x = gp;
+    }
+}
+
+/**
+ * Une os conjuntos de u e v, ligando a raiz maior à menor.
+ */
+static void cc_union(int *parent, int u, int v) {
+    for (;;) {
+        int ru = cc_find(parent, u), rv = cc_find(parent, v);
+        if (ru == rv) return;
+        if (ru < rv) {
+            int t = ru;
+            ru = rv;
+            rv = t;
+        }
+        // Falha se outra thread ligou ru antes; tenta de novo a partir das raízes
+        int expected = ru;
+        if (__atomic_compare_exchange_n(&parent[ru], &expected, rv, 0,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            return;
+        }
+    }
+}
+
+/**
+ * Processa os blocos de vértices distribuídos a esta thread (executada em
+ * paralelo): na primeira passada une os extremos de cada aresta (uma vez
+ * por aresta, a partir do extremo de menor índice); na segunda, escreve em
+ * parent[v] a raiz de v.
+ */
+static void cc_worker(void *arg, unsigned int tid) {
+    cc_job *job = arg;
+    struct grafo *g = job->g;
+    int n = g->n_vertices;
+    (void)tid;
+    for (;;) {
+        int first = __atomic_fetch_add(&job->next, CC_BLOCK, __ATOMIC_RELAXED);
+        if (first >= n) break;
+        int last = first + CC_BLOCK < n ? first + CC_BLOCK : n;
+        for (int u = first; u < last; u++) {
+            if (job->pass) {
+                __atomic_store_n(&job->parent[u], cc_find(job->parent, u), __ATOMIC_RELAXED);
+                continue;
+            }
+            nbr_iter it;
+            for (nbr_begin(g, u, &it); nbr_next(&it); ) {
+                if (it.v > u) cc_union(job->parent, u, it.v);
+            }
+        }
+    }
+}
+
+/**
+ * Calcula só os componentes de g (comp, members e comp_start), em paralelo
+ * se o grafo é grande o bastante; senão faz a análise completa.
+ */
+static void analysis_components(struct grafo *g, struct analise *a) {
+    int n = g->n_vertices;
+    unsigned int nthreads = n < CC_PAR_MIN ? 1 : n_threads();
+    if (nthreads <= 1) {
+        analysis_dfs(g, a);
+        return;
+    }
+    size_t vn = ((size_t)n + 1) * sizeof(int);
+    if (!a->comp) {
+        a->comp       = arena_alloc(g->mem, vn);
+        a->members    = arena_alloc(g->mem, vn);
+        a->comp_start = arena_alloc(g->mem, vn);
+    }
+    int *comp = a->comp;
+    for (int v = 0; v < n; v++) comp[v] = v;
+    cc_job job = { g, comp, 0, 0 };
+    run_parallel(nthreads, cc_worker, &job);
+    job.next = 0;
+    job.pass = 1;
+    run_parallel(nthreads, cc_worker, &job);
+
+    // Numera as raízes em ordem (comp[r] == r só nas raízes, e toda raiz
+    // vem antes dos demais vértices de seu componente) e agrupa os vértices
+    int *count = a->comp_start;
+    int n_comp = 0;
+    for (int v = 0; v < n; v++) {
+        if (comp[v] == v) count[n_comp++] = 0;
+        comp[v] = comp[v] == v ? n_comp - 1 : comp[comp[v]];
+        count[comp[v]]++;
+    }
+    int start = 0;
+    for (int c = 0; c < n_comp; c++) {
+        int k = count[c];
+        count[c] = start;
+        start += k;
+    }
+    for (int v = 0; v < n; v++) a->members[count[comp[v]]++] = v;
+    for (int c = n_comp; c > 0; c--) count[c] = count[c - 1];
+    count[0] = 0;
+    a->n_comp = n_comp;
+    a->has_comp = 1;
+    probe_count((unsigned long long)n, g->adj_off[n], 0, 0);
+}
+
+//------------------------------------------------------------------------------
+// Busca em largura paralela
+//
+// Busca em largura síncrona por níveis com escolha de direção (Beamer,
+// Asanović e Patterson, "Direction-optimizing breadth-first search"): enquanto
+// a fronteira é pequena, cada vértice dela visita seus vizinhos (passo de
+// cima para baixo); quando as arestas da fronteira passam de uma fração das
+// arestas dos vértices ainda não alcançados, cada vértice não alcançado
+// procura um vizinho na fronteira e para no primeiro (passo de baixo para
+// cima). Cada thread junta os vértices que alcança em um buffer próprio, e
+// ao fim do passo os buffers são copiados, em sequência, para a ordem de
+// visita. Passos com pouco trabalho rodam na thread que chamou.
+//
+// A busca pode também procurar arestas entre vértices do mesmo nível, que
+// fecham ciclos ímpares, e parar assim que alguma thread encontra uma. Nos
+// passos de cima para baixo isso sai de graça; os níveis expandidos de baixo
+// para cima são conferidos ao fim da busca.
+
+// Grafos com menos vértices que isso têm a bipartição calculada pela busca
+// em profundidade
+#define BFS_PAR_MIN 65536
+
+// Trabalho (arestas ou vértices examinados) a partir do qual um passo usa
+// várias threads
+#define BFS_PAR_WORK 65536
+
+// Posições pegas de uma vez por uma thread
+#define BFS_BLOCK 256
+
+// Passa a baixo para cima se as arestas da fronteira passam de 1/BFS_ALPHA
+// das arestas dos não alcançados; volta a cima para baixo se a fronteira tem
+// menos de 1/BFS_BETA dos vértices
+#define BFS_ALPHA 14
+#define BFS_BETA  24
+
+enum bfs_step { BFS_TOP_DOWN, BFS_BOTTOM_UP, BFS_CHECK };
+
+/**
+ * Vértices alcançados por uma thread em um passo.
+ */
+typedef struct bfs_buf {
+    int *v;
+    int len, cap;
+    unsigned long long deg;     // soma dos graus dos vértices em v
+    unsigned long long scanned; // arestas examinadas pela thread
+} bfs_buf;
+
+/**
+ * Estado da busca em largura paralela, reaproveitado entre buscas a partir
+ * de origens diferentes.
+ */
+typedef struct bfs_engine {
+    struct grafo *g;
+    unsigned int nthreads;
+    int *level;               // nível de cada vértice (-1 = não alcançado)
+    int *parent;              // pai na árvore da busca, se não for NULL
+    int *order;               // vértices alcançados, na ordem de visita
+    int n_order;
+    unsigned char *bottom_up; // bottom_up[l]: nível l expandido de baixo para cima
+    int scan_lo;              // todos os vértices abaixo deste já foram alcançados
+    unsigned long long m_unvisited; // soma dos graus dos não alcançados
+    int check_odd;            // procurar arestas entre vértices do mesmo nível
+    int odd;                  // uma aresta assim foi encontrada
+    bfs_buf *buf;             // um buffer por thread
+
+    // Passo corrente
+    enum bfs_step step;
+    int cur;                  // nível da fronteira
+    int hi;                   // fim do intervalo distribuído
+    int next;                 // próxima posição a ser distribuída
+} bfs_engine;
+
+static void bfs_init(bfs_engine *e, struct grafo *g, unsigned int nthreads) {
+    int n = g->n_vertices;
+    memset(e, 0, sizeof(*e));
+    e->g = g;
+    e->nthreads = nthreads;
+    e->level = malloc(((size_t)n + 1) * sizeof(int));
+    e->order = malloc(((size_t)n + 1) * sizeof(int));
+    e->bottom_up = malloc((size_t)n + 1);
+    e->buf = calloc(nthreads, sizeof(bfs_buf));
+    if (!e->level || !e->order || !e->bottom_up || !e->buf) exit(EXIT_FAILURE);
+    for (int v = 0; v < n; v++) e->level[v] = -1;
+    e->m_unvisited = g->adj_off[n];
+}
+
+static void bfs_free(bfs_engine *e) {
+    for (unsigned int t = 0; t < e->nthreads; t++) free(e->buf[t].v);
+    free(e->buf);
+    free(e->level);
+    free(e->order);
+    free(e->bottom_up);
+}
+
+static void bfs_push(bfs_buf *b, struct grafo *g, int v) {
+    if (b->len == b->cap) {
+        b->cap = b->cap ? 2 * b->cap : 1024;
+        b->v = realloc(b->v, (size_t)b->cap * sizeof(int));
+        if (!b->v) exit(EXIT_FAILURE);
+    }
+    b->v[b->len++] = v;
+    b->deg += g->adj_off[v + 1] - g->adj_off[v];
+}
+
+/**
+ * Executa a parte desta thread no passo corrente (executada em paralelo).
+ * De cima para baixo e na conferência, as posições distribuídas são de
+ * e->order; de baixo para cima, são os próprios vértices.
+ */
+static void bfs_worker(void *arg, unsigned int tid) {
+    bfs_engine *e = arg;
+    struct grafo *g = e->g;
+    bfs_buf *b = &e->buf[tid];
+    int *level = e->level;
+    int cur = e->cur;
+    unsigned long long scanned = 0;
+    for (;;) {
+        if (e->check_odd && __atomic_load_n(&e->odd, __ATOMIC_RELAXED)) break;
+        int first = __atomic_fetch_add(&e->next, BFS_BLOCK, __ATOMIC_RELAXED);
+        if (first >= e->hi) break;
+        int last = first + BFS_BLOCK < e->hi ? first + BFS_BLOCK : e->hi;
+        for (int i = first; i < last; i++) {
+            if (e->step == BFS_BOTTOM_UP) {
+                // Só esta thread escreve level[v]
+                if (__atomic_load_n(&level[i], __ATOMIC_RELAXED) >= 0) continue;
+                nbr_iter it;
+                for (nbr_begin(g, i, &it); nbr_next(&it); ) {
+                    scanned++;
+                    if (__atomic_load_n(&level[it.v], __ATOMIC_RELAXED) == cur) {
+                        __atomic_store_n(&level[i], cur + 1, __ATOMIC_RELAXED);
+                        if (e->parent) e->parent[i] = it.v;
+                        bfs_push(b, g, i);
+                        break;
+                    }
+                }
+                continue;
+            }
+            int u  = e->order[i];
+            int lu = __atomic_load_n(&level[u], __ATOMIC_RELAXED);
+            if (e->step == BFS_CHECK && !e->bottom_up[lu]) continue;
+            scanned += g->adj_off[u + 1] - g->adj_off[u];
+            nbr_iter it;
+            for (nbr_begin(g, u, &it); nbr_next(&it); ) {
+                int v  = it.v;
+                int lv = __atomic_load_n(&level[v], __ATOMIC_RELAXED);
+                if (lv < 0) {
+                    if (__atomic_compare_exchange_n(&level[v], &lv, cur + 1, 0,
+                                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                        if (e->parent) e->parent[v] = u;
+                        bfs_push(b, g, v);
+                    }
+                } else if (lv == lu && e->check_odd) {
+                    __atomic_store_n(&e->odd, 1, __ATOMIC_RELAXED);
+                }
+            }
+        }
+    }
+    b->scanned += scanned;
+}
+
+/**
+ * Executa um passo sobre as posições [lo, hi) e acrescenta a e->order os
+ * vértices alcançados.
+ * @param work arestas ou vértices a examinar, para decidir se vale paralelizar
+ * @return soma dos graus dos vértices alcançados
+ */
+static unsigned long long bfs_step(bfs_engine *e, enum bfs_step step, int lo, int hi,
+                                   unsigned long long work) {
+    unsigned int nthreads = work < BFS_PAR_WORK ? 1 : e->nthreads;
+    e->step = step;
+    e->next = lo;
+    e->hi   = hi;
+    run_parallel(nthreads, bfs_worker, e);
+    unsigned long long deg = 0;
+    for (unsigned int t = 0; t < nthreads; t++) {
+        bfs_buf *b = &e->buf[t];
+        if (b->len) memcpy(e->order + e->n_order, b->v, (size_t)b->len * sizeof(int));
+        e->n_order += b->len;
+        deg += b->deg;
+        b->len = 0;
+        b->deg = 0;
+    }
+    e->m_unvisited -= deg;
+    return deg;
+}
+
+/**
+ * Busca a partir de src, que ainda não pode ter sido alcançado; os vértices
+ * alcançados são acrescentados a e->order e recebem seu nível em e->level.
+ * @return 0 se e->check_odd e a busca encontrou (e parou em) uma aresta
+ *         entre vértices do mesmo nível, 1 caso contrário
+ */
+static int bfs_run(bfs_engine *e, int src) {
+    struct grafo *g = e->g;
+    int n = g->n_vertices;
+    int begin = e->n_order;
+    unsigned long long m_f = g->adj_off[src + 1] - g->adj_off[src], m_total = m_f;
+    e->level[src] = 0;
+    if (e->parent) e->parent[src] = -1;
+    e->order[e->n_order++] = src;
+    e->m_unvisited -= m_f;
+
+    int f_lo = begin, f_hi = e->n_order, bottom_up = 0, any_bottom_up = 0;
+    for (e->cur = 0; f_lo < f_hi; e->cur++) {
+        if (!bottom_up && m_f > e->m_unvisited / BFS_ALPHA) {
+            bottom_up = 1;
+        } else if (bottom_up && f_hi - f_lo < n / BFS_BETA) {
+            bottom_up = 0;
+        }
+        e->bottom_up[e->cur] = (unsigned char)bottom_up;
+        any_bottom_up |= bottom_up;
+        if (bottom_up) {
+            m_f = bfs_step(e, BFS_BOTTOM_UP, e->scan_lo, n, (unsigned long long)(n - e->scan_lo));
+        } else {
+            m_f = bfs_step(e, BFS_TOP_DOWN, f_lo, f_hi, m_f);
+        }
+        if (e->check_odd && e->odd) return 0;
+        m_total += m_f;
+        f_lo = f_hi;
+        f_hi = e->n_order;
+    }
+    if (e->check_odd && any_bottom_up) {
+        bfs_step(e, BFS_CHECK, begin, e->n_order, m_total);
+        return !e->odd;
+    }
+    return 1;
+}
+
+/**
+ * Calcula a bipartição de g por busca em largura paralela, a partir de cada
+ * vértice ainda não alcançado em ordem de índice, parando no primeiro ciclo
+ * ímpar; em grafos pequenos, faz a análise completa.
+ */
+static void analysis_coloring(struct grafo *g, struct analise *a) {
+    int n = g->n_vertices;
+    unsigned int nthreads = n < BFS_PAR_MIN ? 1 : n_threads();
+    if (nthreads <= 1) {
+        analysis_dfs(g, a);
+        return;
+    }
+    bfs_engine e;
+    bfs_init(&e, g, nthreads);
+    e.check_odd = 1;
+    a->bipartite = 1;
+    for (int r = 0; r < n && a->bipartite; r++) {
+        if (e.level[r] >= 0) continue;
+        e.scan_lo = r;
+        a->bipartite = bfs_run(&e, r);
+    }
+    if (!a->color) a->color = arena_alloc(g->mem, (size_t)n + 1);
+    for (int v = 0; v < n; v++) a->color[v] = (unsigned char)(e.level[v] > 0 ? e.level[v] & 1 : 0);
+    a->has_color = 1;
+
+    unsigned long long scanned = 0;
+    for (unsigned int t = 0; t < nthreads; t++) scanned += e.buf[t].scanned;
+    probe_count((unsigned long long)e.n_order, scanned, 0, 0);
+    bfs_free(&e);
+}
+
+//------------------------------------------------------------------------------
+// Biconectividade em paralelo
+//
+// Algoritmo de Tarjan e Vishkin ("An efficient parallel biconnectivity
+// algorithm"). Sobre uma árvore geradora, aqui a da busca em largura
+// paralela, numeram-se os vértices em pré-ordem (pre) e calculam-se, para a
+// subárvore de cada v, o tamanho (size) e o menor e o maior número alcançado
+// por ela e por suas arestas fora da árvore (low e high). A aresta da árvore
+// entre v e seu pai é identificada por v, e duas dessas arestas ficam no
+// mesmo bloco se
+//   - uma aresta fora da árvore liga suas subárvores sem que um extremo seja
+//     ancestral do outro, ou
+//   - uma é a de v, a outra a de seu pai p, e a subárvore de v alcança algo
+//     fora da subárvore de p (low[v] < pre[p] ou high[v] >= pre[p] + size[p]).
+// Os blocos saem dos conjuntos disjuntos concorrentes de analysis_components.
+// Um vértice é de corte se suas arestas da árvore caem em blocos diferentes,
+// e a aresta de v é ponte se a subárvore de v não alcança nada fora dela.
+// Como na busca em profundidade, as cópias da aresta entre v e seu pai são
+// ignoradas: arestas paralelas contam como uma só.
+//
+// Tamanhos, pré-ordem e low/high passam de um nível da árvore para o
+// seguinte (ou o anterior), em paralelo dentro de cada nível; os demais
+// passos são paralelos sobre todos os vértices.
+
+#define BICONEXIDADE_PAR_MIN 65536 // vértices para usar o cálculo paralelo
+
+// Vértices de um passo a partir dos quais ele usa várias threads
+#define BICON_PAR_WORK 16384
+
+// Vértices pegos de uma vez por uma thread
+#define BICON_BLOCK 1024
+
+static unsigned int estrategia_biconexidade = BICONEXIDADE_SEQUENCIAL;
+
+void define_estrategia_biconexidade(unsigned int estrategia) {
+    estrategia_biconexidade = estrategia;
+}
+
+enum bicon_step {
+    BC_SIZE,      // size, de baixo para cima
+    BC_PRE,       // pre dos filhos, de cima para baixo
+    BC_LOCAL,     // low e high de cada vértice e de suas arestas fora da árvore
+    BC_LOWHIGH,   // low e high das subárvores, de baixo para cima
+    BC_LINK,      // une as arestas da árvore do mesmo bloco
+    BC_LABEL,     // bloco de cada aresta da árvore
+    BC_CUT        // vértices de corte
+};
+
+/**
+ * Estado compartilhado pelo cálculo paralelo da biconectividade.
+ */
+typedef struct bicon_job {
+    struct grafo *g;
+    enum bicon_step step;
+    const int *items;     // vértices do passo (NULL: os próprios índices)
+    int hi, next;         // fim do intervalo e próxima posição a distribuir
+    int *parent;          // pai na árvore (-1 nas raízes)
+    int *child_off;       // filhos de u: child[child_off[u] .. child_off[u + 1] - 1]
+    int *child;
+    int *pre, *size, *low, *high;
+    int *block;           // bloco da aresta da árvore de cada vértice
+    unsigned char *ap;
+    unsigned long long scanned;
+} bicon_job;
+
+/**
+ * Indica se a aresta (u, x) é da árvore (ou cópia dela).
+ */
+static int bicon_tree_edge(const bicon_job *job, int u, int x) {
+    return x == job->parent[u] || job->parent[x] == u;
+}
+
+static void bicon_vertex(bicon_job *job, int u, unsigned long long *scanned) {
+    struct grafo *g = job->g;
+    int *pre = job->pre, *size = job->size, *low = job->low, *high = job->high;
+    const int *c0 = job->child + job->child_off[u], *c1 = job->child + job->child_off[u + 1];
+    switch (job->step) {
+    case BC_SIZE: {
+        int s = 1;
+        for (const int *c = c0; c < c1; c++) s += size[*c];
+        size[u] = s;
+        break;
+    }
+    case BC_PRE: {
+        int next = pre[u] + 1;
+        for (const int *c = c0; c < c1; c++) {
+            pre[*c] = next;
+            next += size[*c];
+        }
+        break;
+    }
+    case BC_LOCAL: {
+        int lo = pre[u], hi = pre[u];
+        *scanned += g->adj_off[u + 1] - g->adj_off[u];
+        nbr_iter it;
+        for (nbr_begin(g, u, &it); nbr_next(&it); ) {
+            int x = it.v;
+            if (bicon_tree_edge(job, u, x)) continue;
+            if (pre[x] < lo) lo = pre[x];
+            if (pre[x] > hi) hi = pre[x];
+        }
+        low[u]  = lo;
+        high[u] = hi;
+        break;
+    }
+    case BC_LOWHIGH:
+        for (const int *c = c0; c < c1; c++) {
+            if (low[*c] < low[u]) low[u] = low[*c];
+            if (high[*c] > high[u]) high[u] = high[*c];
+        }
+        break;
+    case BC_LINK: {
+        int p = job->parent[u];
+        if (p >= 0 && job->parent[p] >= 0 &&
+            (low[u] < pre[p] || high[u] >= pre[p] + size[p])) {
+            cc_union(job->block, u, p);
+        }
+        *scanned += g->adj_off[u + 1] - g->adj_off[u];
+        nbr_iter it;
+        for (nbr_begin(g, u, &it); nbr_next(&it); ) {
+            int x = it.v;
+            // Cada aresta uma vez, a partir do extremo de menor pre; x não é
+            // ancestral de u, e não é descendente se está fora da subárvore
+            if (pre[x] <= pre[u] || pre[x] < pre[u] + size[u]) continue;
+            if (bicon_tree_edge(job, u, x)) continue;
+            cc_union(job->block, u, x);
+        }
+        break;
+    }
+    case BC_LABEL:
+        __atomic_store_n(&job->block[u], cc_find(job->block, u), __ATOMIC_RELAXED);
+        break;
+    case BC_CUT: {
+        int first = job->parent[u] >= 0 ? job->block[u] : -1;
+        for (const int *c = c0; c < c1; c++) {
+            if (first < 0) {
+                first = job->block[*c];
+            } else if (job->block[*c] != first) {
+                job->ap[u] = 1;
+                break;
+            }
+        }
+        break;
+    }
+    }
+}
+
+/**
+ * Processa os vértices do passo corrente distribuídos a esta thread
+ * (executada em paralelo).
+ */
+static void bicon_worker(void *arg, unsigned int tid) {
+    bicon_job *job = arg;
+    unsigned long long scanned = 0;
+    (void)tid;
+    for (;;) {
+        int first = __atomic_fetch_add(&job->next, BICON_BLOCK, __ATOMIC_RELAXED);
+        if (first >= job->hi) break;
+        int last = first + BICON_BLOCK < job->hi ? first + BICON_BLOCK : job->hi;
+        for (int i = first; i < last; i++) {
+            bicon_vertex(job, job->items ? job->items[i] : i, &scanned);
+        }
+    }
+    __atomic_fetch_add(&job->scanned, scanned, __ATOMIC_RELAXED);
+}
+
+static void bicon_run(bicon_job *job, unsigned int nthreads, enum bicon_step step,
+                      const int *items, int lo, int hi) {
+    job->step  = step;
+    job->items = items;
+    job->next  = lo;
+    job->hi    = hi;
+    run_parallel(hi - lo < BICON_PAR_WORK ? 1 : nthreads, bicon_worker, job);
+}
+
+/**
+ * Calcula vértices de corte, pontes e blocos de g pelo algoritmo de Tarjan e
+ * Vishkin, em paralelo, e os componentes se ainda não estão na análise.
+ */
+static void analysis_biconnectivity(struct grafo *g, struct analise *a, unsigned int nthreads) {
+    int n = g->n_vertices;
+    size_t vn = ((size_t)n + 1) * sizeof(int);
+    int *parent    = malloc(vn);
+    int *pre       = malloc(vn);
+    int *size      = malloc(vn);
+    int *low       = malloc(vn);
+    int *high      = malloc(vn);
+    int *child_off = malloc(vn + sizeof(int));
+    int *child     = malloc(vn);
+    int *block     = malloc(vn);
+    int *by_level  = malloc(vn);
+    int *level_off = malloc(vn + sizeof(int));
+    if (!parent || !pre || !size || !low || !high || !child_off || !child ||
+        !block || !by_level || !level_off) {
+        exit(EXIT_FAILURE);
+    }
+
+    // Floresta da busca em largura, com uma raiz por componente (o menor
+    // vértice), e a pré-ordem das raízes: cada componente ocupa o intervalo
+    // de posições que a busca lhe dá em e.order
+    bfs_engine e;
+    bfs_init(&e, g, nthreads);
+    e.parent = parent;
+    int fill_comp = !a->has_comp, n_comp = 0, depth = 0;
+    if (fill_comp && !a->comp) {
+        a->comp       = arena_alloc(g->mem, vn);
+        a->members    = arena_alloc(g->mem, vn);
+        a->comp_start = arena_alloc(g->mem, vn);
+    }
+    for (int r = 0; r < n; r++) {
+        if (e.level[r] >= 0) continue;
+        int begin = e.n_order;
+        e.scan_lo = r;
+        pre[r] = begin;
+        bfs_run(&e, r);
+        if (e.cur > depth) depth = e.cur;
+        if (fill_comp) {
+            a->comp_start[n_comp] = begin;
+            for (int i = begin; i < e.n_order; i++) a->comp[e.order[i]] = n_comp;
+        }
+        n_comp++;
+    }
+
+    // Filhos de cada vértice e vértices agrupados por nível
+    memset(child_off, 0, vn + sizeof(int));
+    memset(level_off, 0, vn + sizeof(int));
+    for (int v = 0; v < n; v++) {
+        if (parent[v] >= 0) child_off[parent[v] + 2]++;
+        level_off[e.level[v] + 2]++;
+    }
+    for (int v = 0; v < n; v++) {
+        child_off[v + 2] += child_off[v + 1];
+        level_off[v + 2] += level_off[v + 1];
+    }
+    for (int v = 0; v < n; v++) {
+        if (parent[v] >= 0) child[child_off[parent[v] + 1]++] = v;
+        by_level[level_off[e.level[v] + 1]++] = v;
+    }
+
+    bicon_job job;
+    memset(&job, 0, sizeof(job));
+    job.g = g;
+    job.parent = parent;
+    job.child_off = child_off;
+    job.child = child;
+    job.pre = pre;
+    job.size = size;
+    job.low = low;
+    job.high = high;
+    job.block = block;
+    job.ap = a->ap = arena_alloc(g->mem, (size_t)n + 1);
+    memset(a->ap, 0, (size_t)n + 1);
+    for (int v = 0; v < n; v++) block[v] = v;
+
+    for (int l = depth; l >= 0; l--) bicon_run(&job, nthreads, BC_SIZE, by_level, level_off[l], level_off[l + 1]);
+    for (int l = 0; l <= depth; l++) bicon_run(&job, nthreads, BC_PRE, by_level, level_off[l], level_off[l + 1]);
+    bicon_run(&job, nthreads, BC_LOCAL, NULL, 0, n);
+    for (int l = depth; l >= 0; l--) bicon_run(&job, nthreads, BC_LOWHIGH, by_level, level_off[l], level_off[l + 1]);
+    bicon_run(&job, nthreads, BC_LINK, NULL, 0, n);
+    bicon_run(&job, nthreads, BC_LABEL, NULL, 0, n);
+    bicon_run(&job, nthreads, BC_CUT, NULL, 0, n);
+
+    // Pontes, blocos (um por raiz dos conjuntos) e vértices de corte
+    a->n_ap = a->n_bridges = a->n_blocks = 0;
+    for (int v = 0; v < n; v++) {
+        a->n_ap += a->ap[v];
+        if (parent[v] < 0) continue;
+        if (block[v] == v) a->n_blocks++;
+        if (low[v] >= pre[v] && high[v] < pre[v] + size[v]) {
+            if (a->n_bridges == a->bridges_cap) {
+                int cap = a->bridges_cap ? 2 * a->bridges_cap : 64;
+                a->bridges = arena_realloc(g->mem, a->bridges,
+                                           2 * (size_t)a->bridges_cap * sizeof(int),
+                                           2 * (size_t)cap * sizeof(int));
+                a->bridges_cap = cap;
+            }
+            a->bridges[2 * a->n_bridges]     = parent[v];
+            a->bridges[2 * a->n_bridges + 1] = v;
+            a->n_bridges++;
+        }
+    }
+    if (fill_comp) {
+        memcpy(a->members, e.order, (size_t)n * sizeof(int));
+        a->comp_start[n_comp] = n;
+        a->n_comp = n_comp;
+        a->has_comp = 1;
+    }
+    a->has_dfs = 1;
+
+    unsigned long long scanned = job.scanned;
+    for (unsigned int t = 0; t < nthreads; t++) scanned += e.buf[t].scanned;
+    probe_count((unsigned long long)n, scanned, 0, 0);
+    bfs_free(&e);
+    free(parent);
+    free(pre);
+    free(size);
+    free(low);
+    free(high);
+    free(child_off);
+    free(child);
+    free(block);
+    free(by_level);
+    free(level_off);
+}
+
+//------------------------------------------------------------------------------
+// Triângulos e coeficiente de agrupamento
+//
+// Os triângulos são contados sobre uma adjacência orientada: os vértices
+// recebem um posto (rank) em ordem crescente de grau e cada aresta vai do
+// extremo de menor posto ao de maior. Nenhum vértice fica com mais que
+// O(sqrt(m)) vizinhos de saída, então a contagem custa O(m^1.5) mesmo com
+// vértices de grau muito alto. As listas de saída ficam em ordem crescente de
+// posto, sem laços e sem repetições (arestas paralelas contam uma vez), e o
+// triângulo de postos r < s < w aparece uma única vez, como w na interseção
+// das listas de r e s.
+// A interseção compara blocos de 4 postos de cada lista com operações
+// vetoriais (4 comparações de um bloco com cada elemento do outro) e, quando
+// uma lista é muito maior que a outra, procura cada elemento da menor na
+// maior por busca exponencial. Os vértices são distribuídos às threads em
+// blocos de postos.
+
+// Grafos com menos meias-arestas que isso contam os triângulos em uma única
+// thread
+#define TRI_PAR_MIN 262144
+
+// Postos pegos de uma vez por uma thread
+#define TRI_BLOCK 1024
+
+// Razão entre os tamanhos das listas a partir da qual a interseção usa busca
+// exponencial na maior
+#define TRI_GALLOP 32
+
+// 4 postos, comparados de uma vez
+typedef int quad __attribute__((vector_size(16)));
+
+/**
+ * Estado compartilhado pela contagem de triângulos.
+ */
+typedef struct tri_job {
+    int n;
+    unsigned int *off;    // início da lista de saída de cada posto
+    unsigned int *end;    // fim da lista de saída de cada posto
+    int *out;             // postos vizinhos de saída, em ordem crescente
+    unsigned long long *tri; // triângulos de cada posto
+    int shared;           // várias threads somam em tri
+    int next;             // próximo posto a ser distribuído
+    unsigned long long total;
+} tri_job;
+
+static void tri_add(tri_job *job, int r, unsigned long long c) {
+    if (job->shared) __atomic_fetch_add(&job->tri[r], c, __ATOMIC_RELAXED);
+    else job->tri[r] += c;
+}
+
+/**
+ * Interseção por busca exponencial: procura cada elemento de a (a menor
+ * lista) em b a partir da posição do anterior.
+ */
+static unsigned int intersect_gallop(tri_job *job, const int *a, unsigned int na,
+                                     const int *b, unsigned int nb) {
+    unsigned int c = 0, j = 0;
+    for (unsigned int i = 0; i < na && j < nb; i++) {
+        int x = a[i];
+        if (b[j] < x) {
+            // b[lo] < x <= b[hi], ou hi = nb
+            unsigned int lo = j, step = 1, hi = j + 1;
+            while (hi < nb && b[hi] < x) {
+                lo = hi;
+                step *= 2;
+                hi = lo + step;
+            }
+            if (hi > nb) hi = nb;
+            while (hi - lo > 1) {
+                unsigned int mid = lo + (hi - lo) / 2;
+                if (b[mid] < x) lo = mid;
+                else hi = mid;
+            }
+            j = hi;
+            if (j == nb) break;
+        }
+        if (b[j] == x) {
+            c++;
+            j++;
+            tri_add(job, x, 1);
+        }
+    }
+    return c;
+}
+
+/**
+ * Interseção por intercalação. Enquanto as duas listas têm 4 elementos, o
+ * bloco de a é comparado de uma vez com cada elemento do bloco de b e avança
+ * o bloco de menor último elemento; como as listas não têm repetições, cada
+ * elemento de a casa no máximo uma vez. O resto é intercalado um a um.
+ */
+static unsigned int intersect_merge(tri_job *job, const int *a, unsigned int na,
+                                    const int *b, unsigned int nb) {
+    unsigned int c = 0, i = 0, j = 0;
+    while (i + 4 <= na && j + 4 <= nb) {
+        quad va, vb;
+        memcpy(&va, a + i, sizeof(va));
+        memcpy(&vb, b + j, sizeof(vb));
+        quad m = (va == vb[0]) | (va == vb[1]) | (va == vb[2]) | (va == vb[3]);
+        if (m[0] | m[1] | m[2] | m[3]) {
+            for (int k = 0; k < 4; k++) {
+                if (!m[k]) continue;
+                c++;
+                tri_add(job, a[i + (unsigned int)k], 1);
+            }
+        }
+        int la = a[i + 3], lb = b[j + 3];
+        if (la <= lb) i += 4;
+        if (lb <= la) j += 4;
+    }
+    while (i < na && j < nb) {
+        if (a[i] < b[j]) {
+            i++;
+        } else if (a[i] > b[j]) {
+            j++;
+        } else {
+            c++;
+            tri_add(job, a[i], 1);
+            i++;
+            j++;
+        }
+    }
+    return c;
+}
+
+/**
+ * Número de elementos comuns às listas ordenadas a e b, somando 1 aos
+ * triângulos de cada um.
+ */
+static unsigned int intersect(tri_job *job, const int *a, unsigned int na,
+                              const int *b, unsigned int nb) {
+    if (na > nb) {
+        const int *t = a;
+        unsigned int tn = na;
+        a  = b;
+        na = nb;
+        b  = t;
+        nb = tn;
+    }
+    if (na == 0) return 0;
+    if (nb / na >= TRI_GALLOP) return intersect_gallop(job, a, na, b, nb);
+    return intersect_merge(job, a, na, b, nb);
+}
+
+/**
+ * Conta os triângulos dos blocos de postos distribuídos a esta thread
+ * (executada em paralelo). Para cada vizinho de saída s de r, os terceiros
+ * vértices estão depois de s na lista de r.
+ */
+static void tri_worker(void *arg, unsigned int tid) {
+    tri_job *job = arg;
+    int n = job->n;
+    unsigned long long total = 0;
+    (void)tid;
+    for (;;) {
+        int first = __atomic_fetch_add(&job->next, TRI_BLOCK, __ATOMIC_RELAXED);
+        if (first >= n) break;
+        int last = first + TRI_BLOCK < n ? first + TRI_BLOCK : n;
+        for (int r = first; r < last; r++) {
+            const int *lr = job->out + job->off[r];
+            unsigned int len = job->end[r] - job->off[r];
+            unsigned long long own = 0;
+            for (unsigned int k = 0; k + 1 < len; k++) {
+                int s = lr[k];
+                unsigned int c = intersect(job, lr + k + 1, len - k - 1,
+                                           job->out + job->off[s], job->end[s] - job->off[s]);
+                if (c == 0) continue;
+                own += c;
+                tri_add(job, s, c);
+            }
+            if (own) tri_add(job, r, own);
+            total += own;
+        }
+    }
+    __atomic_fetch_add(&job->total, total, __ATOMIC_RELAXED);
+}
+
+/**
+ * Conta os triângulos de g e calcula o coeficiente de agrupamento local de
+ * cada vértice, além do global e da média dos locais. Os graus usados são os
+ * do grafo simples (sem laços e arestas paralelas).
+ */
+static void analysis_triangles(struct grafo *g, struct analise *a) {
+    int n = g->n_vertices;
+    int *order = malloc(((size_t)n + 1) * sizeof(int));
+    int *rank = malloc(((size_t)n + 1) * sizeof(int));
+    unsigned int *off = malloc(((size_t)n + 1) * sizeof(unsigned int));
+    unsigned int *end = malloc(((size_t)n + 1) * sizeof(unsigned int));
+    unsigned int *deg = calloc((size_t)n + 1, sizeof(unsigned int));
+    if (!order || !rank || !off || !end || !deg) exit(EXIT_FAILURE);
+    order_by_degree(g, order, 0);
+    for (int r = 0; r < n; r++) rank[order[r]] = r;
+
+    // Listas de saída: percorrendo os postos x em ordem e pondo x na lista de
+    // cada vizinho de posto menor, cada lista sai ordenada e as cópias de uma
+    // aresta paralela chegam seguidas
+    nbr_iter it;
+    off[0] = 0;
+    for (int r = 0; r < n; r++) {
+        unsigned int k = 0;
+        for (nbr_begin(g, order[r], &it); nbr_next(&it); ) {
+            if (rank[it.v] > r) k++;
+        }
+        off[r + 1] = off[r] + k;
+    }
+    int *out = malloc((size_t)off[n] * sizeof(int) + 1);
+    if (!out) exit(EXIT_FAILURE);
+    memcpy(end, off, (size_t)n * sizeof(unsigned int));
+    for (int x = 0; x < n; x++) {
+        for (nbr_begin(g, order[x], &it); nbr_next(&it); ) {
+            int r = rank[it.v];
+            if (r >= x || (end[r] > off[r] && out[end[r] - 1] == x)) continue;
+            out[end[r]++] = x;
+            deg[r]++;
+            deg[x]++;
+        }
+    }
+
+    unsigned long long *tri = calloc((size_t)n + 1, sizeof(unsigned long long));
+    if (!tri) exit(EXIT_FAILURE);
+    unsigned int nthreads = g->adj_off[n] < TRI_PAR_MIN ? 1 : n_threads();
+    tri_job job = { n, off, end, out, tri, nthreads > 1, 0, 0 };
+    run_parallel(nthreads, tri_worker, &job);
+
+    // Agrupamento local 2 t / (d (d - 1)); o global é 3 vezes os triângulos
+    // sobre os caminhos de comprimento 2
+    if (!a->clustering) a->clustering = arena_alloc(g->mem, ((size_t)n + 1) * sizeof(double));
+    unsigned long long wedges = 0;
+    double sum = 0;
+    for (int r = 0; r < n; r++) {
+        double d = deg[r], c = 0;
+        if (deg[r] > 1) {
+            wedges += (unsigned long long)deg[r] * (deg[r] - 1) / 2;
+            c = 2 * (double)tri[r] / (d * (d - 1));
+        }
+        a->clustering[order[r]] = c;
+        sum += c;
+    }
+    a->n_triangles = job.total;
+    a->global_clustering = wedges ? 3 * (double)job.total / (double)wedges : 0;
+    a->mean_clustering = n > 0 ? sum / n : 0;
+    a->has_tri = 1;
+    probe_count((unsigned long long)n, g->adj_off[n] + (unsigned long long)off[n], 0, 0);
+    free(tri);
+    free(out);
+    free(deg);
+    free(end);
+    free(off);
+    free(rank);
+    free(order);
+}
+
+/**
+ * Devolve a análise do grafo com ao menos as partes pedidas calculadas,
+ * descartando a análise anterior se o grafo mudou desde então.
+ * @param g grafo
+ * @param need combinação de AN_COMP, AN_DFS, AN_COLOR e AN_TRI
+ * @return análise, guardada no grafo
+ */
+static struct analise *analysis(struct grafo *g, unsigned int need) {
+    sync_csr(g);
+    struct analise *a = g->cache;
+    if (!a) {
+        a = g->cache = arena_alloc(g->mem, sizeof(struct analise));
+        memset(a, 0, sizeof(*a));
+        if (pthread_mutex_init(&a->alt_lock, NULL) != 0) exit(EXIT_FAILURE);
+        a->versao = g->versao;
+    } else if (a->versao != g->versao) {
+        drop_analysis(g, a);
+        if (pthread_mutex_init(&a->alt_lock, NULL) != 0) exit(EXIT_FAILURE);
+        a->versao = g->versao;
+    }
+    // Sem escrever quando nada mudou: com tudo calculado, analysis só lê
+    if (a->n != g->n_vertices) a->n = g->n_vertices;
+    if ((need & AN_DFS) && !a->has_dfs) {
+        unsigned int nthreads = estrategia_biconexidade == BICONEXIDADE_PARALELA &&
+                                g->n_vertices >= BICONEXIDADE_PAR_MIN ? n_threads() : 1;
+        if (nthreads > 1) {
+            analysis_biconnectivity(g, a, nthreads);
+        } else {
+            analysis_dfs(g, a);
+        }
+    }
+    if ((need & AN_COLOR) && !a->has_color) analysis_coloring(g, a);
+    if ((need & AN_COMP) && !a->has_comp) analysis_components(g, a);
+    if ((need & AN_TRI) && !a->has_tri) analysis_triangles(g, a);
+    return a;
+}
+
+//------------------------------------------------------------------------------
+// Mudanças no grafo
+
+/**
+ * Conjuntos disjuntos com paridade, mantidos enquanto o grafo recebe vértices
+ * e arestas para responder n_componentes e bipartido sem novo percurso.
+ * parity[v] é a paridade do caminho de v até parent[v] em uma 2-coloração
+ * do componente; uma aresta entre vértices de mesma paridade fecha um ciclo
+ * ímpar.
+ */
+struct conjuntos {
+    int *parent;
+    unsigned char *parity;
+    unsigned char *rank;
+    int cap;
+    int n_comp;
+    int bipartite;
+};
+
+/**
+ * Devolve a raiz do conjunto de x e, em *parity, a paridade de x em relação
+ * a ela, comprimindo o caminho percorrido.
+ */
+static int uf_find(struct conjuntos *s, int x, unsigned int *parity) {
+    int r = x;
+    unsigned int p = 0;
+    while (s->parent[r] != r) {
+        p ^= s->parity[r];
+        r = s->parent[r];
+    }
+    *parity = p;
+    // Liga todo o caminho direto à raiz, com a paridade acumulada
+    while (x != r) {
+        int next = s->parent[x];
+        unsigned int px = s->parity[x];
+        s->parent[x] = r;
+        s->parity[x] = (unsigned char)p;
+        p ^= px;
+        x = next;
+    }
+    return r;
+}
+
+/**
+ * Garante espaço nos conjuntos para os vértices de g.
+ */
+static void uf_reserve(struct grafo *g, struct conjuntos *s) {
+    if (g->n_vertices <= s->cap) return;
+    int cap = s->cap ? s->cap : 64;
+    while (cap < g->n_vertices) cap *= 2;
+    s->parent = arena_realloc(g->mem, s->parent, (size_t)s->cap * sizeof(int),
+                              (size_t)cap * sizeof(int));
+    s->parity = arena_realloc(g->mem, s->parity, (size_t)s->cap, (size_t)cap);
+    s->rank   = arena_realloc(g->mem, s->rank, (size_t)s->cap, (size_t)cap);
+    s->cap = cap;
+}
+
+/**
+ * Prepara g para uma mudança: copia a imagem mapeada para a arena e, na
+ * primeira mudança (ou na primeira depois de uma remoção), monta os conjuntos
+ * a partir dos componentes e da bipartição do grafo atual.
+ */
+static void begin_change(struct grafo *g) {
+    detach_mapping(g);
+    if (g->uf) return;
+    struct analise *a = analysis(g, AN_COMP | AN_COLOR);
+    struct conjuntos *s = arena_alloc(g->mem, sizeof(struct conjuntos));
+    memset(s, 0, sizeof(*s));
+    uf_reserve(g, s);
+    for (int v = 0; v < g->n_vertices; v++) {
+        int root = a->members[a->comp_start[a->comp[v]]];
+        s->parent[v] = root;
+        s->parity[v] = a->color[v] ^ a->color[root];
+        s->rank[v]   = v == root;
+    }
+    s->n_comp    = a->n_comp;
+    s->bipartite = a->bipartite;
+    g->uf = s;
+}
+
+/**
+ * Descarta os conjuntos; uma remoção pode separar componentes e desfazer
+ * ciclos ímpares, o que os conjuntos não conseguem acompanhar.
+ */
+static void drop_sets(struct grafo *g) {
+    struct conjuntos *s = g->uf;
+    if (!s) return;
+    arena_release(g->mem, s->parent, (size_t)s->cap * sizeof(int));
+    arena_release(g->mem, s->parity, (size_t)s->cap);
+    arena_release(g->mem, s->rank, (size_t)s->cap);
+    g->uf = NULL;
+}
+
+/**
+ * Acrescenta aos conjuntos o vértice i, recém-criado, sozinho em seu
+ * componente.
+ */
+static void uf_add(struct grafo *g, int i) {
+    struct conjuntos *s = g->uf;
+    uf_reserve(g, s);
+    s->parent[i] = i;
+    s->parity[i] = 0;
+    s->rank[i]   = 0;
+    s->n_comp++;
+}
+
+/**
+ * Une os componentes de u e v, exigindo cores diferentes para os dois; se já
+ * estão no mesmo componente com a mesma cor, a aresta fecha um ciclo ímpar.
+ */
+static void uf_union(struct conjuntos *s, int u, int v) {
+    unsigned int pu, pv;
+    int ru = uf_find(s, u, &pu);
+    int rv = uf_find(s, v, &pv);
+    if (ru == rv) {
+        if (pu == pv) s->bipartite = 0;
+        return;
+    }
+    if (s->rank[ru] < s->rank[rv]) {
+        int t = ru; ru = rv; rv = t;
+    }
+    s->parent[rv] = ru;
+    s->parity[rv] = (unsigned char)(pu ^ pv ^ 1u);
+    if (s->rank[ru] == s->rank[rv]) s->rank[ru]++;
+    s->n_comp--;
+}
+
+/**
+ * Devolve o índice do vértice com o nome dado, criando-o se não existir.
+ * @return índice do vértice ou -1 se o nome for vazio
+ */
+static int change_vertex(struct grafo *g, const char *name) {
+    size_t len = strlen(name);
+    if (len == 0) return -1;
+    unsigned int h = hash_name(name, len);
+    if (g->names.n_slots) {
+        int i = g->names.slots[find_slot(g, name, len, h)].idx;
+        if (i >= 0) return i;
+    }
+    begin_change(g);
+    int i = add_vertex(g, name, len, h);
+    uf_add(g, i);
+    return i;
+}
+
+int adiciona_vertice(struct grafo *g, const char *nome) {
+    if (!g || !nome) return -1;
+    struct sonda p;
+    probe_begin(g, &p, FASE_ADICIONA_VERTICE);
+    int i = change_vertex(g, nome);
+    probe_end(g, &p);
+    return i;
+}
+
+/**
+ * Acrescenta a aresta {u, v} e atualiza os conjuntos.
+ * @return 1 em caso de sucesso, 0 se algum nome for vazio
+ */
+static unsigned int change_edge(struct grafo *g, const char *u, const char *v, int peso) {
+    int iu = change_vertex(g, u);
+    int iv = change_vertex(g, v);
+    if (iu < 0 || iv < 0) return 0;
+    begin_change(g);
+    if (g->streamed) {
+        g->n_arestas++;
+    } else {
+        add_edge(g, iu, iv, peso);
+    }
+    uf_union(g->uf, iu, iv);
+    return 1;
+}
+
+unsigned int adiciona_aresta(struct grafo *g, const char *u, const char *v, int peso) {
+    if (!g || !u || !v || peso < 0) return 0;
+    struct sonda p;
+    probe_begin(g, &p, FASE_ADICIONA_ARESTA);
+    unsigned int ok = change_edge(g, u, v, peso);
+    probe_end(g, &p);
+    return ok;
+}
+
+/**
+ * Marca como removida uma entrada da faixa de u com vizinho v e peso w
+ * (qualquer peso se w < 0).
+ * @return peso da entrada removida ou -1 se não houver
+ */
+static int remove_entry(struct grafo *g, int u, int v, int w) {
+    for (unsigned int e = g->adj_off[u]; e < g->adj_off[u + 1]; e++) {
+        int we = g->adj_w ? g->adj_w[e] : 1;
+        if (g->adj[e] == v && (w < 0 || we == w)) {
+            g->adj[e] = -1;
+            g->n_removed++;
+            return we;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Remove uma aresta {u, v}, se existir.
+ * @return 1 se uma aresta foi removida, 0 caso contrário
+ */
+static unsigned int remove_edge(struct grafo *g, const char *u, const char *v) {
+    int iu = find_vertex_index(g, u);
+    int iv = find_vertex_index(g, v);
+    if (iu < 0 || iv < 0) return 0;
+    detach_mapping(g);
+    expand_csr(g);
+
+    int found = 0;
+    // Arestas ainda fora do CSR, das mais recentes para as mais antigas
+    for (int i = g->n_edges - 1; i >= 0 && !found; i--) {
+        edge_rec *e = &g->edges[i];
+        if ((e->u == iu && e->v == iv) || (e->u == iv && e->v == iu)) {
+            memmove(e, e + 1, (size_t)(g->n_edges - i - 1) * sizeof(edge_rec));
+            g->n_edges--;
+            found = 1;
+        }
+    }
+    // Uma aresta do CSR tem uma entrada em cada extremo (duas em u, se laço)
+    if (!found && iu < g->n_csr && iv < g->n_csr) {
+        int w = remove_entry(g, iu, iv, -1);
+        if (w >= 0) {
+            remove_entry(g, iv, iu, w);
+            found = 1;
+        }
+    }
+    if (!found) return 0;
+    g->n_arestas--;
+    g->versao++;
+    drop_sets(g);
+    return 1;
+}
+
+unsigned int remove_aresta(struct grafo *g, const char *u, const char *v) {
+    if (!g || g->streamed || !u || !v) return 0;
+    struct sonda p;
+    probe_begin(g, &p, FASE_REMOVE_ARESTA);
+    unsigned int ok = remove_edge(g, u, v);
+    probe_end(g, &p);
+    return ok;
+}
+
+//------------------------------------------------------------------------------
+// Leitura em fluxo
+
+/**
+ * Devolve o índice do vértice, criando-o (e seu conjunto) se for novo.
+ */
+static int stream_vertex(struct grafo *g, const char *name, size_t len) {
+    int n = g->n_vertices;
+    int i = get_vertex_index(g, name, len, hash_name(name, len));
+    if (g->n_vertices != n) uf_add(g, i);
+    return i;
+}
+
+/**
+ * Incorpora uma linha aos conjuntos, sem guardar a aresta.
+ */
+static void stream_line(struct grafo *g, const line_tok *t) {
+    if (t->kind == LINE_EDGE) {
+        int i1 = stream_vertex(g, t->a, t->a_len);
+        int i2 = stream_vertex(g, t->b, t->b_len);
+        uf_union(g->uf, i1, i2);
+        g->n_arestas++;
+    } else if (t->kind == LINE_VERTEX) {
+        stream_vertex(g, t->a, t->a_len);
+    }
+}
+
+struct grafo *le_grafo_stream(FILE *f) {
+    if (!f) return NULL;
+    struct sonda p;
+    probe_begin(NULL, &p, FASE_LE_GRAFO_STREAM);
+    struct grafo *g = new_graph();
+    g->streamed = 1;
+    g->uf = arena_alloc(g->mem, sizeof(struct conjuntos));
+    memset(g->uf, 0, sizeof(struct conjuntos));
+    g->uf->bipartite = 1;
+    read_text(f, g, stream_line);
+    probe_loaded(g, &p);
+    return g;
+}
+
+unsigned int n_componentes(struct grafo *g) {
+    if (!g) return 0;
+    struct sonda p;
+    probe_begin(g, &p, FASE_N_COMPONENTES);
+    int n = g->uf ? g->uf->n_comp : analysis(g, AN_COMP)->n_comp;
+    probe_end(g, &p);
+    return (unsigned int)n;
+}
+
+unsigned int bipartido(struct grafo *g) {
+    if (!g) return 0;
+    struct sonda p;
+    probe_begin(g, &p, FASE_BIPARTIDO);
+    int b = g->uf ? g->uf->bipartite : analysis(g, AN_COLOR)->bipartite;
+    probe_end(g, &p);
+    return (unsigned int)b;
+}
+
+static const int INF = INT_MAX / 2;
+
+/**
+ * Área de trabalho reutilizável das buscas de caminhos mínimos: alocada uma
+ * vez por thread e limpa ao fim de cada busca apenas nos vértices que a
+ * busca alcançou.
+ */
+typedef struct sssp_ws {
+    int unit;             // pesos todos 1: busca em largura em vez de Dijkstra
+    int *dist;            // distância a partir da origem (INF = não alcançado)
+    int *heap;            // heap binário de vértices, ordenado por dist (ou fila)
+    int *pos;             // posição do vértice no heap ou -1
+    int *reached;         // vértices alcançados pela última busca
+    int n_reached;
+    // Totais de todas as buscas feitas com esta área (para a instrumentação)
+    unsigned long long settled, scanned, heap_ops;
+} sssp_ws;
+
+/**
+ * Aloca a área de trabalho do Dijkstra para um grafo com n vértices.
+ * @param w área de trabalho
+ * @param n número de vértices
+ */
+static void sssp_ws_init(sssp_ws *w, int n) {
+    size_t sz = ((size_t)n + 1) * sizeof(int);
+    w->dist    = malloc(sz);
+    w->heap    = malloc(sz);
+    w->pos     = malloc(sz);
+    w->reached = malloc(sz);
+    if (!w->dist || !w->heap || !w->pos || !w->reached) exit(EXIT_FAILURE);
+    for (int i = 0; i < n; i++) {
+        w->dist[i] = INF;
+        w->pos[i]  = -1;
+    }
+    w->n_reached = 0;
+    w->unit = 0;
+    w->settled = w->scanned = w->heap_ops = 0;
+}
+
+static void sssp_ws_free(sssp_ws *w) {
+    free(w->dist);
+    free(w->heap);
+    free(w->pos);
+    free(w->reached);
+}
+
+static void heap_up(sssp_ws *w, int i) {
+    int v = w->heap[i], d = w->dist[v];
+    while (i > 0) {
+        int p = (i - 1) / 2;
+        if (w->dist[w->heap[p]] <= d) break;
+        w->heap[i] = w->heap[p];
+        w->pos[w->heap[i]] = i;
+        i = p;
+    }
+    w->heap[i] = v;
+    w->pos[v]  = i;
+}
+
+static void heap_down(sssp_ws *w, int i, int size) {
+    int v = w->heap[i], d = w->dist[v];
+    for (;;) {
+        int c = 2 * i + 1;
+        if (c >= size) break;
+        if (c + 1 < size && w->dist[w->heap[c + 1]] < w->dist[w->heap[c]]) c++;
+        if (w->dist[w->heap[c]] >= d) break;
+        w->heap[i] = w->heap[c];
+        w->pos[w->heap[i]] = i;
+        i = c;
+    }
+    w->heap[i] = v;
+    w->pos[v]  = i;
+}
+
+/**
+ * Calcula as distâncias mínimas de um vértice de origem para os vértices do
+ * seu componente, com um heap binário indexado (decrease-key).
+ * Ao final, w->dist tem as distâncias e w->reached os vértices alcançados;
+ * sssp_reset deve ser chamada antes da próxima busca.
+ * @param g  grafo a ser analisado
+ * @param w  área de trabalho
+ * @param src  índice do vértice de origem
+ * @return  excentricidade de src (maior distância a um vértice alcançado)
+ */
+static int dijkstra(struct grafo *g, sssp_ws *w, int src) {
+    int size = 0, ecc = 0;
+    unsigned long long scanned = 0, ops = 1;
+    w->n_reached = 0;
+    w->dist[src] = 0;
+    w->reached[w->n_reached++] = src;
+    w->heap[size++] = src;
+    w->pos[src] = 0;
+    while (size) {
+        int u = w->heap[0];
+        w->pos[u] = -1;
+        if (--size) {
+            w->heap[0] = w->heap[size];
+            heap_down(w, 0, size);
+        }
+        int du = w->dist[u];
+        if (du > ecc) ecc = du;
+        scanned += g->adj_off[u + 1] - g->adj_off[u];
+        nbr_iter it;
+        for (nbr_begin(g, u, &it); nbr_next(&it); ) {
+            int v  = it.v;
+            int nd = du + g->adj_w[it.e - 1];
+            if (nd < w->dist[v]) {
+                ops++;
+                if (w->dist[v] == INF) {
+                    w->reached[w->n_reached++] = v;
+                    w->heap[size] = v;
+                    w->pos[v] = size++;
+                }
+                w->dist[v] = nd;
+                if (w->pos[v] >= 0) heap_up(w, w->pos[v]);
+            }
+        }
+    }
+    // Cada vértice alcançado sai do heap uma vez
+    w->settled  += (unsigned long long)w->n_reached;
+    w->scanned  += scanned;
+    w->heap_ops += ops + (unsigned long long)w->n_reached;
+    return ecc;
+}
+
+/**
+ * Busca em largura a partir de src, com a mesma interface de dijkstra; só
+ * vale para grafos com todos os pesos iguais a 1. A fila é o próprio vetor
+ * de alcançados.
+ */
+static int bfs(struct grafo *g, sssp_ws *w, int src) {
+    unsigned long long scanned = 0;
+    w->n_reached = 0;
+    w->dist[src] = 0;
+    w->reached[w->n_reached++] = src;
+    for (int head = 0; head < w->n_reached; head++) {
+        int u  = w->reached[head];
+        int du = w->dist[u] + 1;
+        scanned += g->adj_off[u + 1] - g->adj_off[u];
+        nbr_iter it;
+        for (nbr_begin(g, u, &it); nbr_next(&it); ) {
+            int v = it.v;
+            if (w->dist[v] == INF) {
+                w->dist[v] = du;
+                w->reached[w->n_reached++] = v;
+            }
+        }
+    }
+    w->settled += (unsigned long long)w->n_reached;
+    w->scanned += scanned;
+    // O último alcançado é o mais distante
+    return w->dist[w->reached[w->n_reached - 1]];
+}
+
+/**
+ * Distâncias mínimas a partir de src, por busca em largura se w->unit.
+ * @return excentricidade de src
+ */
+static int shortest_paths(struct grafo *g, sssp_ws *w, int src) {
+    return w->unit ? bfs(g, w, src) : dijkstra(g, w, src);
+}
+
+/**
+ * Restaura w->dist para INF nos vértices alcançados pela última busca.
+ */
+static void sssp_reset(sssp_ws *w) {
+    for (int i = 0; i < w->n_reached; i++) w->dist[w->reached[i]] = INF;
+    w->n_reached = 0;
+}
+
+//------------------------------------------------------------------------------
+// Distância entre dois vértices
+//
+// distancia faz uma busca bidirecional: uma busca a partir de cada ponta,
+// avançando a de menor heap, até que as chaves no topo dos dois heaps
+// garantam que nenhum caminho ainda não visto é mais curto que o melhor já
+// encontrado (mu). Com o índice de marcos (prepara_distancias), a busca é
+// guiada por limites inferiores ALT (Goldberg e Harrelson, "Computing the
+// shortest path: A* search meets graph theory"): pela desigualdade
+// triangular, |d(L, v) - d(L, t)| <= d(v, t) para todo marco L, e o maior
+// desses valores é um potencial consistente pi_t(v). Os dois lados usam o
+// potencial médio p(v) = (pi_t(v) - pi_s(v)) / 2, com sinais opostos, o
+// que dá aos dois as mesmas arestas reduzidas não negativas; as chaves
+// guardam o dobro dos valores para continuarem inteiras. Sem marcos no
+// componente, p = 0 e a busca é a bidirecional comum.
+//
+// Os marcos são escolhidos pelo mais distante: em cada componente que os
+// recebe, o primeiro é o vértice mais distante de um vértice qualquer e
+// cada um dos seguintes o mais distante dos já escolhidos. O índice guarda,
+// para cada vértice, as distâncias a todos os marcos lado a lado, que é como
+// a busca as lê. Ao construir o índice, uma calibração decide se ele guia
+// as consultas ou se só descarta pares em componentes diferentes.
+
+// Marcos de prepara_distancias com n_marcos = 0
+#define ALT_DEFAULT 16
+
+// Maior número de marcos de um índice
+#define ALT_MAX 64
+
+// Componentes com menos vértices que isso não recebem marcos
+#define ALT_MIN_COMP 64
+
+// Marcos usados em cada consulta: os que dão o maior limite para d(s, t)
+#define ALT_ACTIVE 4
+
+// Pares de vértices da calibração dos marcos
+#define ALT_SAMPLE 32
+
+// Os marcos só guiam as consultas se a busca comum fechar ao menos ALT_GAIN
+// vezes mais vértices na calibração: cada vértice custa mais com potencial
+#define ALT_GAIN 2
+
+#define ALT_MAGIC   "GRAFOALT"
+#define ALT_VERSION 1u
+
+/**
+ * Cabeçalho do arquivo do índice de marcos, seguido dos marcos e das
+ * distâncias (n_vertices * n_landmarks inteiros).
+ */
+typedef struct alt_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t endian;          // BIN_ENDIAN na ordem de bytes de quem gravou
+    uint32_t n_vertices;
+    uint32_t n_landmarks;
+    uint32_t guided;          // resultado da calibração
+    uint32_t reserved;        // zero
+    uint64_t graph_sum;       // graph_fingerprint do grafo indexado
+    uint64_t payload_sum;     // checksum dos marcos e das distâncias
+    uint64_t header_sum;      // checksum dos campos anteriores
+} alt_header;
+
+/**
+ * Um lado da busca bidirecional.
+ */
+typedef struct alt_side {
+    long long *key;       // 2 dist + potencial do lado (dobrado)
+    int *dist;            // distância a partir da ponta do lado (INF = não alcançado)
+    int *heap;            // heap binário de vértices, ordenado por key
+    int *pos;             // posição do vértice no heap ou -1
+    int *reached;         // vértices alcançados, para a limpeza
+    int n_reached, size;
+} alt_side;
+
+/**
+ * Área de trabalho de uma consulta de distância. Cada consulta pega uma das
+ * áreas livres guardadas na análise do grafo (ou cria uma) e a devolve ao
+ * terminar, de modo que consultas em threads diferentes não dividem área e
+ * cada uma só limpa o que alcançou. Ocupa um único bloco de alt_ws_size
+ * bytes, fora da arena, que não pode ser usada por duas threads.
+ */
+struct alt_ws {
+    alt_side side[2];     // 0: a partir da origem; 1: a partir do destino
+    int k;                // marcos usados na consulta corrente
+    int sign[2];          // sinal do potencial em cada lado
+    int ds[ALT_ACTIVE], dt[ALT_ACTIVE]; // distâncias da origem e do destino aos marcos
+    int lm[ALT_ACTIVE];   // marcos usados (índices no índice)
+    unsigned long long settled, scanned, heap_ops;
+    unsigned long long limit; // interrompe a busca após tantos vértices fechados
+};
+
+static size_t alt_ws_size(int n) {
+    size_t vn = (size_t)n + 1;
+    return sizeof(struct alt_ws) + 2 * vn * (sizeof(long long) + 4 * sizeof(int));
+}
+
+static struct alt_ws *alt_ws_new(int n) {
+    size_t vn = (size_t)n + 1;
+    struct alt_ws *w = malloc(alt_ws_size(n));
+    if (!w) exit(EXIT_FAILURE);
+    memset(w, 0, sizeof(*w));
+    w->limit = ULLONG_MAX;
+    char *p = (char *)(w + 1);
+    for (int s = 0; s < 2; s++) {
+        alt_side *d = &w->side[s];
+        d->key     = (long long *)(void *)p; p += vn * sizeof(long long);
+        d->dist    = (int *)(void *)p; p += vn * sizeof(int);
+        d->heap    = (int *)(void *)p; p += vn * sizeof(int);
+        d->pos     = (int *)(void *)p; p += vn * sizeof(int);
+        d->reached = (int *)(void *)p; p += vn * sizeof(int);
+        for (int v = 0; v < n; v++) {
+            d->dist[v] = INF;
+            d->pos[v]  = -1;
+        }
+    }
+    return w;
+}
+
+/**
+ * Pega uma área de trabalho livre da análise ou cria uma nova.
+ */
+static struct alt_ws *alt_ws_take(struct analise *a) {
+    pthread_mutex_lock(&a->alt_lock);
+    struct alt_ws *w = a->alt_n ? a->alt_pool[--a->alt_n] : NULL;
+    pthread_mutex_unlock(&a->alt_lock);
+    return w ? w : alt_ws_new(a->n);
+}
+
+/**
+ * Devolve a área de trabalho às livres da análise.
+ */
+static void alt_ws_put(struct analise *a, struct alt_ws *w) {
+    pthread_mutex_lock(&a->alt_lock);
+    if (a->alt_n == a->alt_cap) {
+        a->alt_cap = a->alt_cap ? 2 * a->alt_cap : 8;
+        a->alt_pool = realloc(a->alt_pool, (size_t)a->alt_cap * sizeof(struct alt_ws *));
+        if (!a->alt_pool) exit(EXIT_FAILURE);
+    }
+    a->alt_pool[a->alt_n++] = w;
+    pthread_mutex_unlock(&a->alt_lock);
+}
+
+/**
+ * Potencial dobrado do vértice v, pi_t(v) - pi_s(v), com os marcos da
+ * consulta corrente.
+ */
+static long long alt_potential(const struct analise *a, const struct alt_ws *w, int v) {
+    const int *dv = a->lm_dist + (size_t)v * (size_t)a->n_landmarks;
+    int pt = 0, ps = 0;
+    for (int i = 0; i < w->k; i++) {
+        int d = dv[w->lm[i]];
+        int x = d > w->dt[i] ? d - w->dt[i] : w->dt[i] - d;
+        int y = d > w->ds[i] ? d - w->ds[i] : w->ds[i] - d;
+        if (x > pt) pt = x;
+        if (y > ps) ps = y;
+    }
+    return (long long)pt - ps;
+}
+
+// Ordem do heap: menor chave e, no empate, maior distância, que tende a
+// estar mais perto do outro extremo
+static int alt_before(const alt_side *d, int x, int y) {
+    return d->key[x] < d->key[y] || (d->key[x] == d->key[y] && d->dist[x] > d->dist[y]);
+}
+
+static void alt_heap_up(alt_side *d, int i) {
+    int v = d->heap[i];
+    while (i > 0) {
+        int p = (i - 1) / 2;
+        if (!alt_before(d, v, d->heap[p])) break;
+        d->heap[i] = d->heap[p];
+        d->pos[d->heap[i]] = i;
+        i = p;
+    }
+    d->heap[i] = v;
+    d->pos[v]  = i;
+}
+
+static void alt_heap_down(alt_side *d, int i) {
+    int v = d->heap[i];
+    for (;;) {
+        int c = 2 * i + 1;
+        if (c >= d->size) break;
+        if (c + 1 < d->size && alt_before(d, d->heap[c + 1], d->heap[c])) c++;
+        if (!alt_before(d, d->heap[c], v)) break;
+        d->heap[i] = d->heap[c];
+        d->pos[d->heap[i]] = i;
+        i = c;
+    }
+    d->heap[i] = v;
+    d->pos[v]  = i;
+}
+
+/**
+ * Põe v no lado s com distância dist, ou diminui sua distância.
+ */
+static void alt_reach(const struct analise *a, struct alt_ws *w, int s, int v, int dist) {
+    alt_side *d = &w->side[s];
+    if (d->dist[v] == INF) {
+        d->reached[d->n_reached++] = v;
+        d->dist[v] = dist;
+        d->key[v]  = 2 * (long long)dist + w->sign[s] * alt_potential(a, w, v);
+        d->heap[d->size] = v;
+        d->pos[v] = d->size++;
+    } else {
+        d->key[v] -= 2 * (long long)(d->dist[v] - dist);
+        d->dist[v] = dist;
+    }
+    alt_heap_up(d, d->pos[v]);
+    w->heap_ops++;
+}
+
+/**
+ * Tira do heap do lado s o vértice de menor chave e relaxa suas arestas,
+ * atualizando mu com os caminhos que encontram o outro lado.
+ */
+static void alt_settle(struct grafo *g, const struct analise *a, struct alt_ws *w, int s,
+                       int *mu) {
+    alt_side *d = &w->side[s], *o = &w->side[1 - s];
+    int u = d->heap[0];
+    d->pos[u] = -1;
+    if (--d->size) {
+        d->heap[0] = d->heap[d->size];
+        alt_heap_down(d, 0);
+    }
+    w->settled++;
+    w->heap_ops++;
+    int du = d->dist[u];
+    w->scanned += g->adj_off[u + 1] - g->adj_off[u];
+    nbr_iter it;
+    for (nbr_begin(g, u, &it); nbr_next(&it); ) {
+        int v  = it.v;
+        int nd = du + (g->adj_w ? g->adj_w[it.e - 1] : 1);
+        // Um vértice já fechado não volta ao heap: com potencial
+        // consistente, sua distância já é a final
+        if (nd < d->dist[v] && (d->dist[v] == INF || d->pos[v] >= 0)) alt_reach(a, w, s, v, nd);
+        if (o->dist[v] != INF && nd + o->dist[v] < *mu) *mu = nd + o->dist[v];
+    }
+}
+
+/**
+ * Restaura os dois lados para a próxima consulta.
+ */
+static void alt_reset(struct alt_ws *w) {
+    for (int s = 0; s < 2; s++) {
+        alt_side *d = &w->side[s];
+        for (int i = 0; i < d->n_reached; i++) {
+            d->dist[d->reached[i]] = INF;
+            d->pos[d->reached[i]]  = -1;
+        }
+        d->n_reached = d->size = 0;
+    }
+}
+
+/**
+ * Distância entre src e dst pela busca bidirecional na área de trabalho w,
+ * guiada pelos marcos do índice que estão no componente das pontas se a
+ * calibração os aprovou. Só lê o grafo e a análise. Os contadores da busca
+ * ficam em w até a próxima.
+ * @return distância ou -1 se não há caminho
+ */
+static int alt_distance(struct grafo *g, const struct analise *a, struct alt_ws *w,
+                        int src, int dst) {
+    if (src == dst) return 0;
+    if (a->has_comp && a->comp[src] != a->comp[dst]) return -1;
+    w->settled = w->scanned = w->heap_ops = 0;
+    w->k = 0;
+    int nl = a->n_landmarks;
+    for (int i = 0; i < nl; i++) {
+        int x = a->lm_dist[(size_t)src * (size_t)nl + (size_t)i];
+        int y = a->lm_dist[(size_t)dst * (size_t)nl + (size_t)i];
+        if (x == INF && y == INF) continue;
+        // Um marco que alcança só uma das pontas as separa
+        if (x == INF || y == INF) return -1;
+        if (!a->alt_guided) continue;
+        // Inserção ordenada por limite decrescente, só dos ALT_ACTIVE maiores
+        int lb = x > y ? x - y : y - x, j = w->k < ALT_ACTIVE ? w->k++ : ALT_ACTIVE;
+        for (; j > 0; j--) {
+            int lj = w->ds[j - 1] > w->dt[j - 1] ? w->ds[j - 1] - w->dt[j - 1]
+                                                   : w->dt[j - 1] - w->ds[j - 1];
+            if (lj >= lb) break;
+            if (j < ALT_ACTIVE) {
+                w->lm[j] = w->lm[j - 1];
+                w->ds[j] = w->ds[j - 1];
+                w->dt[j] = w->dt[j - 1];
+            }
+        }
+        if (j < ALT_ACTIVE) {
+            w->lm[j] = i;
+            w->ds[j] = x;
+            w->dt[j] = y;
+        }
+    }
+    w->sign[0] = 1;
+    w->sign[1] = -1;
+    alt_reach(a, w, 0, src, 0);
+    alt_reach(a, w, 1, dst, 0);
+    int mu = INF;
+    alt_side *f = &w->side[0], *r = &w->side[1];
+    while (f->size && r->size && w->settled < w->limit) {
+        if (f->key[f->heap[0]] + r->key[r->heap[0]] >= 2 * (long long)mu) break;
+        alt_settle(g, a, w, f->size <= r->size ? 0 : 1, &mu);
+    }
+    alt_reset(w);
+    probe_count(w->settled, w->scanned, 1, w->heap_ops);
+    return mu == INF ? -1 : mu;
+}
+
+// splitmix64
+static uint64_t mix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+/**
+ * Decide se os marcos guiam as consultas. Em grafos de diâmetro pequeno a
+ * busca bidirecional comum já fecha poucos vértices e o potencial não se
+ * paga; em grades e outros grafos de diâmetro grande ele reduz a busca em
+ * uma ordem de grandeza. Compara as duas buscas em ALT_SAMPLE pares
+ * sorteados de forma determinística, com a comum interrompida assim que
+ * fecha ALT_GAIN vezes os vértices fechados com os marcos.
  */
-typedef struct edge_pair {
-    char *u;
-    char *v;
-} edge_pair;
+static void calibrate_landmarks(struct grafo *g, struct analise *a) {
+    a->alt_guided = 0;
+    if (a->n_landmarks == 0) return;
+    struct alt_ws *w = alt_ws_take(a);
+    int src[ALT_SAMPLE], dst[ALT_SAMPLE], m = 0;
+    uint64_t x = (uint64_t)a->n;
+    for (int i = 0; i < 4 * ALT_SAMPLE && m < ALT_SAMPLE; i++) {
+        int s = (int)((x = mix64(x)) % (uint64_t)a->n), c = a->comp[s];
+        int size = a->comp_start[c + 1] - a->comp_start[c];
+        int t = a->members[a->comp_start[c] + (int)((x = mix64(x)) % (uint64_t)size)];
+        if (s == t) continue;
+        src[m] = s;
+        dst[m++] = t;
+    }
+    unsigned long long guided = 0, plain = 0;
+    a->alt_guided = 1;
+    for (int i = 0; i < m; i++) {
+        alt_distance(g, a, w, src[i], dst[i]);
+        guided += w->settled;
+    }
+    a->alt_guided = 0;
+    for (int i = 0; i < m && plain < ALT_GAIN * guided; i++) {
+        w->limit = ALT_GAIN * guided - plain;
+        alt_distance(g, a, w, src[i], dst[i]);
+        plain += w->settled;
+    }
+    w->limit = ULLONG_MAX;
+    alt_ws_put(a, w);
+    a->alt_guided = m > 0 && plain >= ALT_GAIN * guided;
+}
 
-static int time_dfs_br;
+/**
+ * Devolve à arena o índice de marcos.
+ */
+static void drop_landmarks(struct grafo *g, struct analise *a) {
+    size_t k = (size_t)a->n_landmarks;
+    arena_release(g->mem, a->landmarks, (k + 1) * sizeof(int));
+    arena_release(g->mem, a->lm_dist, ((size_t)a->n * k + 1) * sizeof(int));
+    a->landmarks = a->lm_dist = NULL;
+    a->n_landmarks = a->alt_guided = 0;
+}
 
 /**
- * Realiza uma busca em profundidade (DFS) para encontrar pontes no grafo.
- * @param g  grafo a ser analisado
- * @param u  vértice atual
- * @param visited  vetor de controle de visitados
- * @param disc  vetor de descoberta (tempo de visita)
- * @param low  vetor de menor descoberta alcançada
- * @param parent  vetor de pais na DFS
- * @param bridges  vetor de ponte (pares de arestas)
- * @param bcount  contador de pontes encontradas
- */
-static void bridge_dfs(struct grafo *g, int u, int *visited, int *disc, int *low, int *parent, edge_pair **bridges, int *bcount) {
-    visited[u] = 1;
-    disc[u] = low[u] = ++time_dfs_br;
-
-    adj_node *p = g->adj[u];
-    while (p) {
-        int v = p->v;
-        if (!visited[v]) {
-            parent[v] = u;
-            bridge_dfs(g, v, visited, disc, low, parent, bridges, bcount);
-            low[u] = (low[u] < low[v]) ? low[u] : low[v];
-            if (low[v] > disc[u]) {
-                // (u,v) é ponte — grava par de nomes em ordem alfabética
-                edge_pair *ep = malloc(sizeof(edge_pair));
-                if (!ep) exit(EXIT_FAILURE);
-                if (strcmp(g->vertices[u], g->vertices[v]) < 0) {
-                    ep->u = g->vertices[u];
-                    ep->v = g->vertices[v];
-                } else {
-                    ep->u = g->vertices[v];
-                    ep->v = g->vertices[u];
-                }
-                bridges[(*bcount)++] = ep;
+ * Escolhe os marcos e calcula suas distâncias a todos os vértices, com
+ * n_marcos distribuídos entre os componentes de ao menos ALT_MIN_COMP
+ * vértices proporcionalmente ao tamanho (ao menos um por componente, do
+ * maior para o menor, enquanto houver).
+ */
+static void build_landmarks(struct grafo *g, struct analise *a, int n_marcos) {
+    int n = g->n_vertices, n_comp = a->n_comp;
+    uint64_t *by_size = malloc(((size_t)n_comp + 1) * sizeof(uint64_t));
+    int *quota = malloc(((size_t)n_comp + 1) * sizeof(int));
+    if (!by_size || !quota) exit(EXIT_FAILURE);
+    long long big = 0;
+    for (int c = 0; c < n_comp; c++) {
+        int size = a->comp_start[c + 1] - a->comp_start[c];
+        // Maior tamanho primeiro; no empate, o componente de menor número
+        by_size[c] = (uint64_t)(uint32_t)(INT_MAX - size) << 32 | (uint32_t)c;
+        if (size >= ALT_MIN_COMP) big += size;
+    }
+    qsort(by_size, (size_t)n_comp, sizeof(uint64_t), cmp_u64);
+    int k = 0;
+    for (int i = 0; i < n_comp && k < n_marcos; i++) {
+        int c = (int)(by_size[i] & 0xffffffffu);
+        int size = a->comp_start[c + 1] - a->comp_start[c];
+        if (size < ALT_MIN_COMP) break;
+        int q = (int)((long long)n_marcos * size / big);
+        if (q < 1) q = 1;
+        if (q > n_marcos - k) q = n_marcos - k;
+        quota[i] = q;
+        k += q;
+    }
+
+    drop_landmarks(g, a);
+    a->n_landmarks = k;
+    a->landmarks = arena_alloc(g->mem, ((size_t)k + 1) * sizeof(int));
+    a->lm_dist = arena_alloc(g->mem, ((size_t)n * (size_t)k + 1) * sizeof(int));
+    for (size_t i = 0; i < (size_t)n * (size_t)k; i++) a->lm_dist[i] = INF;
+
+    int *mind = malloc(((size_t)n + 1) * sizeof(int));
+    if (!mind) exit(EXIT_FAILURE);
+    sssp_ws ws;
+    sssp_ws_init(&ws, n);
+    ws.unit = has_unit_weights(g);
+    int l = 0, i = 0;
+    for (; l < k; i++) {
+        int c = (int)(by_size[i] & 0xffffffffu);
+        const int *m = a->members + a->comp_start[c];
+        int size = a->comp_start[c + 1] - a->comp_start[c];
+        // O primeiro marco é o vértice mais distante de m[0]
+        shortest_paths(g, &ws, m[0]);
+        int next = m[0];
+        for (int r = 1; r < ws.n_reached; r++) {
+            if (ws.dist[ws.reached[r]] > ws.dist[next]) next = ws.reached[r];
+        }
+        sssp_reset(&ws);
+        for (int j = 0; j < size; j++) mind[m[j]] = INF;
+        for (int j = 0; j < quota[i]; j++) {
+            shortest_paths(g, &ws, next);
+            a->landmarks[l] = next;
+            for (int r = 0; r < ws.n_reached; r++) {
+                int v = ws.reached[r];
+                a->lm_dist[(size_t)v * (size_t)k + (size_t)l] = ws.dist[v];
+                if (ws.dist[v] < mind[v]) mind[v] = ws.dist[v];
+            }
+            l++;
+            sssp_reset(&ws);
+            // O seguinte é o mais distante dos já escolhidos
+            for (int r = 0; r < size; r++) {
+                if (mind[m[r]] > mind[next]) next = m[r];
             }
-        } else if (v != parent[u]) {
-            low[u] = (low[u] < disc[v]) ? low[u] : disc[v];
         }
-        p = p->next;
     }
+    // Uma busca por marco e uma inicial por componente
+    probe_count(ws.settled, ws.scanned, (unsigned long long)(k + i), ws.heap_ops);
+    sssp_ws_free(&ws);
+    free(mind);
+    free(quota);
+    free(by_size);
 }
 
-char *arestas_corte(struct grafo *g) {
-    if (!g) return NULL;
-    int n = g->n_vertices;
-    int *visited = calloc(n, sizeof(int));
-    int *disc    = malloc(n * sizeof(int));
-    int *low     = malloc(n * sizeof(int));
-    int *parent  = malloc(n * sizeof(int));
-    if (!visited || !disc || !low || !parent) exit(EXIT_FAILURE);
-
-    // Máximo de pontes em grafo simples << n*(n-1)/2
-    edge_pair **bridges = malloc((n * (n - 1) / 2) * sizeof(edge_pair *));
-    if (!bridges) exit(EXIT_FAILURE);
+/**
+ * Resumo do grafo que o índice de marcos depende: nomes na ordem dos
+ * índices e, de cada vértice, o conjunto de vizinhos com pesos (sem depender
+ * da ordem das listas, que muda com define_compressao).
+ */
+static uint64_t graph_fingerprint(struct grafo *g) {
+    checksum c;
+    checksum_init(&c);
+    nbr_iter it;
+    for (int u = 0; u < g->n_vertices; u++) {
+        const char *name = vertex_name(g, u);
+        checksum_update(&c, name, strlen(name) + 1);
+        uint64_t sum = 0;
+        for (nbr_begin(g, u, &it); nbr_next(&it); ) {
+            uint64_t x = (uint64_t)(uint32_t)it.v << 32 |
+                         (uint32_t)(g->adj_w ? g->adj_w[it.e - 1] : 1);
+            // Somado para não depender da ordem
+            sum += mix64(x);
+        }
+        checksum_word(&c, sum);
+    }
+    return checksum_final(&c);
+}
 
-    for (int i = 0; i < n; i++) {
-        visited[i] = 0;
-        parent[i]  = -1;
+static uint64_t alt_header_checksum(const alt_header *h) {
+    checksum c;
+    checksum_init(&c);
+    checksum_update(&c, h, offsetof(alt_header, header_sum));
+    return checksum_final(&c);
+}
+
+static unsigned int write_landmarks(struct grafo *g, struct analise *a, const char *caminho) {
+    FILE *f = fopen(caminho, "wb");
+    if (!f) return 0;
+    size_t k = (size_t)a->n_landmarks, nd = (size_t)a->n * k;
+    alt_header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, ALT_MAGIC, 8);
+    h.version     = ALT_VERSION;
+    h.endian      = BIN_ENDIAN;
+    h.n_vertices  = (uint32_t)a->n;
+    h.n_landmarks = (uint32_t)k;
+    h.guided      = (uint32_t)a->alt_guided;
+    h.graph_sum   = graph_fingerprint(g);
+    checksum c;
+    checksum_init(&c);
+    checksum_update(&c, a->landmarks, k * sizeof(int));
+    checksum_update(&c, a->lm_dist, nd * sizeof(int));
+    h.payload_sum = checksum_final(&c);
+    h.header_sum  = alt_header_checksum(&h);
+    int ok = fwrite(&h, sizeof(h), 1, f) == 1 &&
+             fwrite(a->landmarks, sizeof(int), k, f) == k &&
+             fwrite(a->lm_dist, sizeof(int), nd, f) == nd;
+    if (fclose(f) != 0) ok = 0;
+    if (!ok) remove(caminho);
+    return ok ? 1 : 0;
+}
+
+static unsigned int read_landmarks(struct grafo *g, struct analise *a, const char *caminho) {
+    FILE *f = fopen(caminho, "rb");
+    if (!f) return 0;
+    alt_header h;
+    if (fread(&h, sizeof(h), 1, f) != 1 || memcmp(h.magic, ALT_MAGIC, 8) != 0 ||
+        h.version != ALT_VERSION || h.endian != BIN_ENDIAN ||
+        h.header_sum != alt_header_checksum(&h) || h.n_vertices != (uint32_t)a->n ||
+        h.n_landmarks > ALT_MAX || h.guided > 1 || h.reserved != 0 || h.graph_sum != graph_fingerprint(g)) {
+        fclose(f);
+        return 0;
     }
-    time_dfs_br = 0;
-    int bcount = 0;
-    for (int i = 0; i < n; i++) {
-        if (!visited[i]) {
-            bridge_dfs(g, i, visited, disc, low, parent, bridges, &bcount);
+    size_t k = h.n_landmarks, nd = (size_t)a->n * k;
+    int *lm = arena_alloc(g->mem, (k + 1) * sizeof(int));
+    int *dist = arena_alloc(g->mem, (nd + 1) * sizeof(int));
+    int ok = fread(lm, sizeof(int), k, f) == k && fread(dist, sizeof(int), nd, f) == nd &&
+             fgetc(f) == EOF;
+    if (ok) {
+        checksum c;
+        checksum_init(&c);
+        checksum_update(&c, lm, k * sizeof(int));
+        checksum_update(&c, dist, nd * sizeof(int));
+        ok = checksum_final(&c) == h.payload_sum;
+    }
+    for (size_t i = 0; ok && i < k; i++) ok = lm[i] >= 0 && lm[i] < a->n;
+    fclose(f);
+    if (!ok) {
+        arena_release(g->mem, lm, (k + 1) * sizeof(int));
+        arena_release(g->mem, dist, (nd + 1) * sizeof(int));
+        return 0;
+    }
+    drop_landmarks(g, a);
+    a->n_landmarks = (int)k;
+    a->landmarks = lm;
+    a->lm_dist = dist;
+    a->alt_guided = (int)h.guided;
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// Saída das consultas
+//
+// As consultas que devolvem listas escrevem por meio de um destino de saída,
+// que acumula o texto em uma string de crescimento geométrico (para as
+// funções que devolvem char *) ou o repassa a um FILE * (para as funções
+// escreve_*), sem montar a string inteira.
+
+/**
+ * Destino de saída: string em memória (f == NULL) ou arquivo.
+ */
+typedef struct out_sink {
+    FILE *f;
+    char *s;
+    size_t len;
+    size_t cap;
+} out_sink;
+
+static void out_init_str(out_sink *o) {
+    o->f   = NULL;
+    o->cap = 64;
+    o->len = 0;
+    o->s   = malloc(o->cap);
+    if (!o->s) exit(EXIT_FAILURE);
+    o->s[0] = '\0';
+}
+
+static void out_init_file(out_sink *o, FILE *f) {
+    o->f   = f;
+    o->s   = NULL;
+    o->len = o->cap = 0;
+}
+
+static void out_write(out_sink *o, const char *p, size_t n) {
+    if (o->f) {
+        fwrite(p, 1, n, o->f);
+        return;
+    }
+    if (o->len + n + 1 > o->cap) {
+        while (o->len + n + 1 > o->cap) o->cap *= 2;
+        o->s = realloc(o->s, o->cap);
+        if (!o->s) exit(EXIT_FAILURE);
+    }
+    memcpy(o->s + o->len, p, n);
+    o->len += n;
+    o->s[o->len] = '\0';
+}
+
+static void out_str(out_sink *o, const char *s) {
+    out_write(o, s, strlen(s));
+}
+
+static void out_int(out_sink *o, int v) {
+    char temp[16];
+    int len = snprintf(temp, sizeof(temp), "%d", v);
+    out_write(o, temp, (size_t)len);
+}
+
+/**
+ * Encerra a saída.
+ * @return a string montada (destino em memória) ou NULL
+ */
+static char *out_finish(out_sink *o) {
+    return o->s;
+}
+
+static int cmp_int(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+static int cmp_name(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+//------------------------------------------------------------------------------
+/**
+ * Estado compartilhado pelo cálculo paralelo das excentricidades.
+ * As origens são os vértices de members, agrupados por componente;
+ * as threads pegam blocos de origens de um contador comum.
+ */
+typedef struct ecc_job {
+    struct grafo *g;
+    const int *members;   // vértices agrupados por componente
+    const int *comp_of;   // componente de cada posição de members
+    int n_members;
+    int next;             // próxima posição de members a ser distribuída
+    int *diam;            // maior excentricidade de cada componente
+    unsigned long searches; // buscas executadas
+} ecc_job;
+
+// Origens pegas de uma vez por uma thread
+#define ECC_BLOCK 16
+
+/**
+ * Atualiza *slot com max(*slot, val) de forma atômica.
+ */
+static void atomic_max(int *slot, int val) {
+    int cur = __atomic_load_n(slot, __ATOMIC_RELAXED);
+    while (val > cur &&
+           !__atomic_compare_exchange_n(slot, &cur, val, 0,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+/**
+ * Roda Dijkstra de cada origem distribuída a esta thread e acumula o máximo
+ * por componente (executada em paralelo).
+ */
+static void ecc_worker(void *arg, unsigned int tid) {
+    ecc_job *job = arg;
+    sssp_ws ws;
+    unsigned long searches = 0;
+    (void)tid;
+    sssp_ws_init(&ws, job->g->n_vertices);
+    for (;;) {
+        int first = __atomic_fetch_add(&job->next, ECC_BLOCK, __ATOMIC_RELAXED);
+        if (first >= job->n_members) break;
+        int last = first + ECC_BLOCK < job->n_members ? first + ECC_BLOCK : job->n_members;
+        for (int j = first; j < last; j++) {
+            int ecc = dijkstra(job->g, &ws, job->members[j]);
+            sssp_reset(&ws);
+            searches++;
+            atomic_max(&job->diam[job->comp_of[j]], ecc);
+        }
+    }
+    __atomic_fetch_add(&job->searches, searches, __ATOMIC_RELAXED);
+    probe_count(ws.settled, ws.scanned, searches, ws.heap_ops);
+    sssp_ws_free(&ws);
+}
+
+//------------------------------------------------------------------------------
+// Excentricidades por busca em largura de várias origens
+//
+// Em grafos com todos os pesos iguais a 1, as excentricidades de um lote de
+// até MSBFS_LANES origens saem de uma única busca em largura: cada vértice
+// guarda um conjunto de bits (um por origem) dos que já o alcançaram (seen),
+// dos que chegaram nele no nível corrente (cur) e dos que chegam no próximo
+// (next). Expandir a fronteira é next[v] |= cur[u] & ~seen[v] para cada
+// aresta (u, v), feito sobre vetores de MSBFS_LANES bits. A excentricidade de
+// uma origem é o último nível em que seu bit ainda aparece na fronteira.
+// As origens de um lote são consecutivas em members, logo em geral do mesmo
+// componente, e compartilham a mesma varredura das arestas. Em grafos de
+// diâmetro grande (caminhos, ciclos) as fronteiras das origens pouco se
+// sobrepõem e a busca comum não compensa; nesse caso a thread passa a fazer
+// uma busca em largura simples por origem.
+
+// Bits de um vértice: 4 palavras de 64 bits, operadas como um vetor
+typedef uint64_t lanes __attribute__((vector_size(32)));
+
+#define MSBFS_WORDS 4
+#define MSBFS_LANES (MSBFS_WORDS * 64)
+
+// Memória total das áreas de trabalho das threads da busca de várias origens
+#define MSBFS_MEM_BUDGET ((size_t)1 << 30)
+
+// Origens que, em média, devem compartilhar cada aresta examinada para que
+// a busca de várias origens continue sendo usada
+#define MSBFS_MIN_SHARE 16
+
+static int lanes_any(const lanes *x) {
+    return ((*x)[0] | (*x)[1] | (*x)[2] | (*x)[3]) != 0;
+}
+
+/**
+ * Área de trabalho de uma thread da busca de várias origens.
+ */
+typedef struct msbfs_ws {
+    lanes *seen;          // origens que já alcançaram cada vértice
+    lanes *cur;           // origens na fronteira corrente, por vértice
+    lanes *next;          // origens na próxima fronteira, por vértice
+    int *front;           // vértices da fronteira corrente
+    int *front_next;      // vértices da próxima fronteira
+    int *touched;         // vértices com seen não nulo, para a limpeza
+    unsigned long long settled, scanned; // totais para a instrumentação
+} msbfs_ws;
+
+/**
+ * Bytes usados por uma thread de msbfs_worker em um grafo com n vértices:
+ * a área de trabalho da busca de várias origens e a de sssp_ws.
+ */
+static size_t msbfs_ws_size(int n) {
+    return (size_t)n * (3 * sizeof(lanes) + 7 * sizeof(int));
+}
+
+static lanes *msbfs_lanes(int n) {
+    void *p = NULL;
+    if (posix_memalign(&p, 64, ((size_t)n + 1) * sizeof(lanes)) != 0) exit(EXIT_FAILURE);
+    memset(p, 0, ((size_t)n + 1) * sizeof(lanes));
+    return p;
+}
+
+static void msbfs_ws_init(msbfs_ws *w, int n) {
+    w->seen       = msbfs_lanes(n);
+    w->cur        = msbfs_lanes(n);
+    w->next       = msbfs_lanes(n);
+    w->front      = malloc(((size_t)n + 1) * sizeof(int));
+    w->front_next = malloc(((size_t)n + 1) * sizeof(int));
+    w->touched    = malloc(((size_t)n + 1) * sizeof(int));
+    if (!w->front || !w->front_next || !w->touched) exit(EXIT_FAILURE);
+    w->settled = w->scanned = 0;
+}
+
+static void msbfs_ws_free(msbfs_ws *w) {
+    free(w->seen);
+    free(w->cur);
+    free(w->next);
+    free(w->front);
+    free(w->front_next);
+    free(w->touched);
+}
+
+/**
+ * Calcula as excentricidades das origens src[0 .. k - 1] (distintas, com
+ * k <= MSBFS_LANES) e deixa w limpa para o próximo lote.
+ * @param ecc recebe a excentricidade de cada origem
+ * @return 1 se as origens compartilharam ao menos MSBFS_MIN_SHARE vezes, em
+ *         média, as arestas examinadas
+ */
+static int msbfs(struct grafo *g, msbfs_ws *w, const int *src, int k, int *ecc) {
+    lanes *seen = w->seen, *cur = w->cur, *next = w->next;
+    int n_front = 0, n_touched = 0;
+    unsigned long long scanned = 0;
+
+    for (int i = 0; i < k; i++) {
+        int s = src[i];
+        seen[s][i / 64] |= (uint64_t)1 << (i % 64);
+        cur[s] = seen[s];
+        w->front[n_front++] = s;
+        w->touched[n_touched++] = s;
+        ecc[i] = 0;
+    }
+
+    for (int level = 1; n_front > 0; level++) {
+        int n_next = 0;
+        for (int f = 0; f < n_front; f++) {
+            int u = w->front[f];
+            lanes cu = cur[u];
+            scanned += g->adj_off[u + 1] - g->adj_off[u];
+            nbr_iter it;
+            for (nbr_begin(g, u, &it); nbr_next(&it); ) {
+                int v = it.v;
+                lanes nv = cu & ~seen[v];
+                if (!lanes_any(&nv)) continue;
+                if (!lanes_any(&next[v])) w->front_next[n_next++] = v;
+                next[v] |= nv;
+            }
+        }
+        for (int f = 0; f < n_front; f++) cur[w->front[f]] = (lanes){ 0, 0, 0, 0 };
+
+        // A nova fronteira passa a ser a corrente; as origens que ainda
+        // alcançaram alguém têm excentricidade ao menos level
+        lanes alive = { 0, 0, 0, 0 };
+        for (int f = 0; f < n_next; f++) {
+            int v = w->front_next[f];
+            if (!lanes_any(&seen[v])) w->touched[n_touched++] = v;
+            seen[v] |= next[v];
+            cur[v] = next[v];
+            alive |= next[v];
+            next[v] = (lanes){ 0, 0, 0, 0 };
+        }
+        for (int j = 0; j < MSBFS_WORDS; j++) {
+            for (uint64_t b = alive[j]; b; b &= b - 1) ecc[j * 64 + __builtin_ctzll(b)] = level;
         }
+        int *t = w->front;
+        w->front = w->front_next;
+        w->front_next = t;
+        n_front = n_next;
     }
-    if (bcount == 0) {
-        free(visited); free(disc); free(low); free(parent); free(bridges);
-        char *res = malloc(1);
-        res[0] = '\0';
-        return res;
+
+    // reach: arestas que uma busca de uma só origem examinaria
+    unsigned long long reach = 0;
+    for (int i = 0; i < n_touched; i++) {
+        int v = w->touched[i];
+        seen[v] = (lanes){ 0, 0, 0, 0 };
+        reach += g->adj_off[v + 1] - g->adj_off[v];
     }
-    // Ordena pares de pontes lexicograficamente pelo primeiro nome, depois pelo segundo
-    for (int i = 0; i < bcount - 1; i++) {
-        for (int j = i + 1; j < bcount; j++) {
-            if (strcmp(bridges[i]->u, bridges[j]->u) > 0 ||
-               (strcmp(bridges[i]->u, bridges[j]->u) == 0 &&
-                strcmp(bridges[i]->v, bridges[j]->v) > 0)) {
-                edge_pair *tmp = bridges[i];
-                bridges[i] = bridges[j];
-                bridges[j] = tmp;
+    w->settled += (unsigned long long)n_touched;
+    w->scanned += scanned;
+    return (unsigned long long)k * reach >= MSBFS_MIN_SHARE * scanned;
+}
+
+/**
+ * Versão de ecc_worker para grafos sem pesos: distribui as origens em lotes
+ * de MSBFS_LANES e calcula cada lote com uma busca de várias origens.
+ */
+static void msbfs_worker(void *arg, unsigned int tid) {
+    ecc_job *job = arg;
+    msbfs_ws ws;
+    sssp_ws single;
+    int ecc[MSBFS_LANES];
+    int shared = 1;
+    unsigned long searches = 0;
+    (void)tid;
+    msbfs_ws_init(&ws, job->g->n_vertices);
+    sssp_ws_init(&single, job->g->n_vertices);
+    single.unit = 1;
+    for (;;) {
+        int first = __atomic_fetch_add(&job->next, MSBFS_LANES, __ATOMIC_RELAXED);
+        if (first >= job->n_members) break;
+        int k = job->n_members - first < MSBFS_LANES ? job->n_members - first : MSBFS_LANES;
+        if (shared) {
+            // Lotes pequenos (o último) não dizem nada sobre o compartilhamento
+            if (!msbfs(job->g, &ws, job->members + first, k, ecc) && k == MSBFS_LANES) shared = 0;
+        } else {
+            for (int i = 0; i < k; i++) {
+                ecc[i] = bfs(job->g, &single, job->members[first + i]);
+                sssp_reset(&single);
             }
         }
+        searches += (unsigned long)k;
+        for (int i = 0; i < k; i++) atomic_max(&job->diam[job->comp_of[first + i]], ecc[i]);
     }
-    // Calcula tamanho total da string
-    int length = 0;
-    for (int i = 0; i < bcount; i++) {
-        length += strlen(bridges[i]->u) + 1 + strlen(bridges[i]->v) + (i < bcount - 1 ? 1 : 0);
+    __atomic_fetch_add(&job->searches, searches, __ATOMIC_RELAXED);
+    probe_count(ws.settled + single.settled, ws.scanned + single.scanned, searches, 0);
+    msbfs_ws_free(&ws);
+    sssp_ws_free(&single);
+}
+
+/**
+ * Calcula as excentricidades das origens de job em paralelo, com Dijkstra ou,
+ * se todos os pesos de g são 1, com a busca de várias origens.
+ */
+static void run_ecc_job(ecc_job *job, unsigned int nthreads) {
+    if (!has_unit_weights(job->g)) {
+        run_parallel(nthreads, ecc_worker, job);
+        return;
+    }
+    // Cada thread ocupa msbfs_ws_size bytes; limita o total a MSBFS_MEM_BUDGET
+    unsigned int batches = (unsigned int)(job->n_members + MSBFS_LANES - 1) / MSBFS_LANES;
+    size_t per_thread = msbfs_ws_size(job->g->n_vertices) + 1;
+    size_t fit = MSBFS_MEM_BUDGET / per_thread;
+    if (nthreads > fit) nthreads = fit > 0 ? (unsigned int)fit : 1;
+    if (nthreads > batches) nthreads = batches > 0 ? batches : 1;
+    run_parallel(nthreads, msbfs_worker, job);
+}
+
+//------------------------------------------------------------------------------
+// Diâmetro por limites de excentricidade
+//
+// Para cada componente mantêm-se limites inferior e superior da
+// excentricidade de cada vértice (Takes & Kosters, "Determining the diameter
+// of small world networks"). Uma busca a partir de v, com excentricidade e,
+// garante para todo w: max(d(v,w), e - d(v,w)) <= ecc(w) <= e + d(v,w).
+// O diâmetro fica entre o maior limite inferior e o maior limite superior;
+// as origens alternam entre o vértice de maior limite superior e o de menor
+// limite inferior, e vértices que não podem mais alterar os limites do
+// diâmetro são descartados. Em geral poucas buscas bastam. Se o limite de
+// buscas for atingido, os candidatos restantes passam pela busca exaustiva.
+
+// Buscas feitas pelo método dos limites antes de recorrer à busca exaustiva
+#define BOUND_MAX_SEARCHES 128
+
+static unsigned int estrategia_config = DIAMETRO_LIMITES;
+
+void define_estrategia_diametros(unsigned int estrategia) {
+    estrategia_config = estrategia;
+}
+
+/**
+ * Estado compartilhado pelo cálculo dos diâmetros por limites.
+ */
+typedef struct bound_job {
+    struct grafo *g;
+    int *members;         // vértices agrupados por componente
+    const int *comp_start; // início de cada componente em members
+    int comp_count;
+    int next;             // próximo componente a ser distribuído
+    int *ecc_lo;          // limite inferior da excentricidade de cada vértice
+    int *ecc_hi;          // limite superior da excentricidade de cada vértice
+    int *n_left;          // candidatos restantes de cada componente
+    int *diam;            // maior limite inferior de cada componente
+    int unit;             // pesos todos 1: buscas em largura
+    unsigned long searches;
+} bound_job;
+
+static int degree(struct grafo *g, int v) {
+    return (int)(g->adj_off[v + 1] - g->adj_off[v]);
+}
+
+/**
+ * Calcula o diâmetro de um componente pelo método dos limites.
+ * @param g grafo
+ * @param ws área de trabalho das buscas
+ * @param m vértices do componente; ao final, m[0 .. *n_left - 1] são os
+ *          candidatos que ainda podem ter excentricidade maior que o retorno
+ * @param k número de vértices do componente
+ * @param ecc_lo limites inferiores (indexado por vértice)
+ * @param ecc_hi limites superiores (indexado por vértice)
+ * @param n_left número de candidatos restantes (0 se o diâmetro é exato)
+ * @param searches contador de buscas executadas
+ * @return maior excentricidade conhecida do componente
+ */
+static int bound_component(struct grafo *g, sssp_ws *ws, int *m, int k,
+                           int *ecc_lo, int *ecc_hi, int *n_left,
+                           unsigned long *searches) {
+    int cand = k, dlo = 0, pick_hi = 1;
+    int v = m[0];
+    for (int j = 0; j < k; j++) {
+        ecc_lo[m[j]] = 0;
+        ecc_hi[m[j]] = INF;
+        if (degree(g, m[j]) > degree(g, v)) v = m[j];
+    }
+    for (unsigned long done = 0; cand > 0 && done < BOUND_MAX_SEARCHES; done++) {
+        int e = shortest_paths(g, ws, v);
+        (*searches)++;
+        if (e > dlo) dlo = e;
+        int dhi = dlo;
+        for (int j = 0; j < cand; j++) {
+            int w = m[j], d = ws->dist[w];
+            int lo = d > e - d ? d : e - d;
+            if (lo > ecc_lo[w]) ecc_lo[w] = lo;
+            if (e + d < ecc_hi[w]) ecc_hi[w] = e + d;
+            if (ecc_lo[w] > dlo) dlo = ecc_lo[w];
+            if (ecc_hi[w] > dhi) dhi = ecc_hi[w];
+        }
+        sssp_reset(ws);
+
+        // Descarta quem não altera mais os limites e escolhe a próxima origem
+        int c = 0, best_hi = -1, best_lo = -1;
+        for (int j = 0; j < cand; j++) {
+            int w = m[j];
+            if (ecc_lo[w] == ecc_hi[w] ||
+                (ecc_hi[w] <= dlo && 2 * ecc_lo[w] >= dhi)) {
+                continue;
+            }
+            m[c++] = w;
+            if (best_hi < 0 || ecc_hi[w] > ecc_hi[best_hi] ||
+                (ecc_hi[w] == ecc_hi[best_hi] && degree(g, w) > degree(g, best_hi))) {
+                best_hi = w;
+            }
+            if (best_lo < 0 || ecc_lo[w] < ecc_lo[best_lo] ||
+                (ecc_lo[w] == ecc_lo[best_lo] && degree(g, w) > degree(g, best_lo))) {
+                best_lo = w;
+            }
+        }
+        cand = c;
+        if (dlo >= dhi) cand = 0;
+        if (cand == 0) break;
+        v = pick_hi ? best_hi : best_lo;
+        pick_hi = !pick_hi;
+    }
+
+    // Só interessam à busca exaustiva os vértices que podem superar dlo
+    int c = 0;
+    for (int j = 0; j < cand; j++) {
+        if (ecc_hi[m[j]] > dlo) m[c++] = m[j];
+    }
+    *n_left = c;
+    return dlo;
+}
+
+/**
+ * Calcula os diâmetros dos componentes distribuídos a esta thread pelo
+ * método dos limites (executada em paralelo).
+ */
+static void bound_worker(void *arg, unsigned int tid) {
+    bound_job *job = arg;
+    sssp_ws ws;
+    unsigned long searches = 0;
+    (void)tid;
+    sssp_ws_init(&ws, job->g->n_vertices);
+    ws.unit = job->unit;
+    for (;;) {
+        int c = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED);
+        if (c >= job->comp_count) break;
+        int *m = job->members + job->comp_start[c];
+        int k = job->comp_start[c + 1] - job->comp_start[c];
+        if (k == 1) {
+            // Vértice isolado: diâmetro 0, sem busca
+            job->diam[c]   = 0;
+            job->n_left[c] = 0;
+            continue;
+        }
+        job->diam[c] = bound_component(job->g, &ws, m, k, job->ecc_lo, job->ecc_hi,
+                                       &job->n_left[c], &searches);
+    }
+    __atomic_fetch_add(&job->searches, searches, __ATOMIC_RELAXED);
+    probe_count(ws.settled, ws.scanned, searches, ws.heap_ops);
+    sssp_ws_free(&ws);
+}
+
+// Grafos com menos vértices que isso usam uma única thread em diametros
+#define ECC_PAR_MIN 1024
+
+/**
+ * Calcula os diâmetros dos componentes conexos de g, ou os reaproveita da
+ * análise do grafo se já foram calculados com a estratégia corrente.
+ * @param g grafo a ser analisado
+ * @return vetor com os diâmetros em ordem não decrescente, um por componente
+ *         (pertence à análise do grafo)
+ */
+static int *component_diameters(struct grafo *g) {
+    struct analise *a = analysis(g, AN_COMP);
+    if (a->diam && a->diam_strategy == estrategia_config) return a->diam;
+
+    int n = g->n_vertices;
+    int comp_count  = a->n_comp;
+    int *comp_start = a->comp_start;
+    int n_members   = comp_start[comp_count];
+    // A busca por limites reordena os candidatos; trabalha sobre uma cópia
+    int *members = malloc(((size_t)n + 1) * sizeof(int));
+    int *comp_of = malloc(((size_t)n + 1) * sizeof(int));
+    if (!members || !comp_of) exit(EXIT_FAILURE);
+    memcpy(members, a->members, (size_t)n_members * sizeof(int));
+
+    if (!a->diam) a->diam = arena_alloc(g->mem, (size_t)comp_count * sizeof(int));
+    int *diam = a->diam;
+    memset(diam, 0, (size_t)comp_count * sizeof(int));
+
+    unsigned int nthreads = n < ECC_PAR_MIN ? 1 : n_threads();
+    unsigned long searches = 0;
+    if (estrategia_config == DIAMETRO_LIMITES) {
+        int *ecc_lo = malloc(((size_t)n + 1) * sizeof(int));
+        int *ecc_hi = malloc(((size_t)n + 1) * sizeof(int));
+        int *n_left = malloc(((size_t)n + 1) * sizeof(int));
+        if (!ecc_lo || !ecc_hi || !n_left) exit(EXIT_FAILURE);
+        bound_job bj = { g, members, comp_start, comp_count, 0,
+                         ecc_lo, ecc_hi, n_left, diam, has_unit_weights(g), 0 };
+        run_parallel(nthreads, bound_worker, &bj);
+        searches = bj.searches;
+
+        // Candidatos não resolvidos seguem para a busca exaustiva
+        int left = 0;
+        for (int c = 0; c < comp_count; c++) {
+            for (int j = 0; j < n_left[c]; j++) {
+                comp_of[left]   = c;
+                members[left++] = members[comp_start[c] + j];
+            }
+        }
+        n_members = left;
+        free(ecc_lo);
+        free(ecc_hi);
+        free(n_left);
+    } else {
+        for (int c = 0; c < comp_count; c++) {
+            for (int j = comp_start[c]; j < comp_start[c + 1]; j++) comp_of[j] = c;
+        }
+    }
+
+    // O diâmetro de cada componente é a maior excentricidade entre seus vértices
+    ecc_job job = { g, members, comp_of, n_members, 0, diam, 0 };
+    run_ecc_job(&job, nthreads);
+    g->n_buscas = searches + job.searches;
+    free(members);
+    free(comp_of);
+
+    // Ordena diametros em ordem não decrescente
+    qsort(diam, (size_t)comp_count, sizeof(int), cmp_int);
+    a->diam_strategy = estrategia_config;
+    return diam;
+}
+
+/**
+ * Escreve os diâmetros dos componentes de g, separados por espaço.
+ */
+static void write_diameters(struct grafo *g, out_sink *o) {
+    int *diam = component_diameters(g);
+    int count = g->cache->n_comp;
+    for (int i = 0; i < count; i++) {
+        if (i > 0) out_write(o, " ", 1);
+        out_int(o, diam[i]);
+    }
+}
+
+char *diametros(struct grafo *g) {
+    if (!g || g->streamed) return NULL;
+    struct sonda p;
+    probe_begin(g, &p, FASE_DIAMETROS);
+    out_sink o;
+    out_init_str(&o);
+    write_diameters(g, &o);
+    probe_end(g, &p);
+    return out_finish(&o);
+}
+
+unsigned int escreve_diametros(struct grafo *g, FILE *f) {
+    if (!g || g->streamed || !f) return 0;
+    struct sonda p;
+    probe_begin(g, &p, FASE_ESCREVE_DIAMETROS);
+    out_sink o;
+    out_init_file(&o, f);
+    write_diameters(g, &o);
+    probe_end(g, &p);
+    return !ferror(f);
+}
+
+//------------------------------------------------------------------------------
+// Biconectividade: vértices de corte, pontes e blocos
+
+unsigned int n_blocos(struct grafo *g) {
+    if (!g || g->streamed) return 0;
+    struct sonda p;
+    probe_begin(g, &p, FASE_N_BLOCOS);
+    int n = analysis(g, AN_DFS)->n_blocks;
+    probe_end(g, &p);
+    return (unsigned int)n;
+}
+
+/**
+ * Escreve os vértices de corte de g em ordem alfabética, separados por espaço.
+ */
+static void write_cut_vertices(struct grafo *g, out_sink *o) {
+    int n = g->n_vertices;
+    struct analise *b = analysis(g, AN_DFS);
+    int count = b->n_ap;
+    if (count == 0) return;
+    // Coleta nomes e ordena
+    char **names = malloc((size_t)count * sizeof(char *));
+    if (!names) exit(EXIT_FAILURE);
+    int idx = 0;
+    for (int i = 0; i < n; i++) {
+        if (b->ap[i]) {
+            names[idx++] = vertex_name(g, i);
+        }
+    }
+    qsort(names, (size_t)count, sizeof(char *), cmp_name);
+    for (int i = 0; i < count; i++) {
+        if (i > 0) out_write(o, " ", 1);
+        out_str(o, names[i]);
     }
-    char *res = malloc(length + 1);
-    if (!res) exit(EXIT_FAILURE);
-    res[0] = '\0';
+    free(names);
+}
+
+char *vertices_corte(struct grafo *g) {
+    if (!g || g->streamed) return NULL;
+    struct sonda p;
+    probe_begin(g, &p, FASE_VERTICES_CORTE);
+    out_sink o;
+    out_init_str(&o);
+    write_cut_vertices(g, &o);
+    probe_end(g, &p);
+    return out_finish(&o);
+}
+
+unsigned int escreve_vertices_corte(struct grafo *g, FILE *f) {
+    if (!g || g->streamed || !f) return 0;
+    struct sonda p;
+    probe_begin(g, &p, FASE_ESCREVE_VERTICES_CORTE);
+    out_sink o;
+    out_init_file(&o, f);
+    write_cut_vertices(g, &o);
+    probe_end(g, &p);
+    return !ferror(f);
+}
+
+/**
+ *  Estrutura para armazenar pares de arestas (u, v) onde u < v
+ *  representa uma aresta de corte.
+ */
+typedef struct edge_pair {
+    char *u;
+    char *v;
+} edge_pair;
+
+static int cmp_edge_pair(const void *a, const void *b) {
+    const edge_pair *x = a, *y = b;
+    int c = strcmp(x->u, y->u);
+    return c ? c : strcmp(x->v, y->v);
+}
+
+/**
+ * Escreve as arestas de corte de g em ordem alfabética, cada uma como o par
+ * de nomes de seus extremos em ordem alfabética, separados por espaço.
+ */
+static void write_cut_edges(struct grafo *g, out_sink *o) {
+    struct analise *b = analysis(g, AN_DFS);
+    int bcount = b->n_bridges;
+    if (bcount == 0) return;
+    // Grava cada ponte como par de nomes em ordem alfabética
+    edge_pair *bridges = malloc((size_t)bcount * sizeof(edge_pair));
+    if (!bridges) exit(EXIT_FAILURE);
     for (int i = 0; i < bcount; i++) {
-        if (i > 0) strcat(res, " ");
-        strcat(res, bridges[i]->u);
-        strcat(res, " ");
-        strcat(res, bridges[i]->v);
+        char *u = vertex_name(g, b->bridges[2 * i]);
+        char *v = vertex_name(g, b->bridges[2 * i + 1]);
+        edge_pair *ep = &bridges[i];
+        if (strcmp(u, v) < 0) {
+            ep->u = u;
+            ep->v = v;
+        } else {
+            ep->u = v;
+            ep->v = u;
+        }
     }
+    // Ordena pares de pontes lexicograficamente pelo primeiro nome, depois pelo segundo
+    qsort(bridges, (size_t)bcount, sizeof(edge_pair), cmp_edge_pair);
     for (int i = 0; i < bcount; i++) {
-        free(bridges[i]);
+        if (i > 0) out_write(o, " ", 1);
+        out_str(o, bridges[i].u);
+        out_write(o, " ", 1);
+        out_str(o, bridges[i].v);
     }
     free(bridges);
-    free(visited); free(disc); free(low); free(parent);
-    return res;
+}
+
+char *arestas_corte(struct grafo *g) {
+    if (!g || g->streamed) return NULL;
+    struct sonda p;
+    probe_begin(g, &p, FASE_ARESTAS_CORTE);
+    out_sink o;
+    out_init_str(&o);
+    write_cut_edges(g, &o);
+    probe_end(g, &p);
+    return out_finish(&o);
+}
+
+unsigned int escreve_arestas_corte(struct grafo *g, FILE *f) {
+    if (!g || g->streamed || !f) return 0;
+    struct sonda p;
+    probe_begin(g, &p, FASE_ESCREVE_ARESTAS_CORTE);
+    out_sink o;
+    out_init_file(&o, f);
+    write_cut_edges(g, &o);
+    probe_end(g, &p);
+    return !ferror(f);
+}
+
+//------------------------------------------------------------------------------
+// Triângulos e coeficiente de agrupamento
+
+unsigned long long n_triangulos(struct grafo *g) {
+    if (!g || g->streamed) return 0;
+    struct sonda p;
+    probe_begin(g, &p, FASE_N_TRIANGULOS);
+    unsigned long long t = analysis(g, AN_TRI)->n_triangles;
+    probe_end(g, &p);
+    return t;
+}
+
+double coeficiente_agrupamento(struct grafo *g) {
+    if (!g || g->streamed) return 0;
+    struct sonda p;
+    probe_begin(g, &p, FASE_COEFICIENTE_AGRUPAMENTO);
+    double c = analysis(g, AN_TRI)->global_clustering;
+    probe_end(g, &p);
+    return c;
+}
+
+double coeficiente_agrupamento_medio(struct grafo *g) {
+    if (!g || g->streamed) return 0;
+    struct sonda p;
+    probe_begin(g, &p, FASE_COEFICIENTE_AGRUPAMENTO_MEDIO);
+    double c = analysis(g, AN_TRI)->mean_clustering;
+    probe_end(g, &p);
+    return c;
+}
+
+double coeficiente_agrupamento_local(struct grafo *g, const char *nome) {
+    if (!g || g->streamed || !nome) return -1;
+    struct sonda p;
+    probe_begin(g, &p, FASE_COEFICIENTE_AGRUPAMENTO_LOCAL);
+    int v = find_vertex_index(g, nome);
+    double c = v < 0 ? -1 : analysis(g, AN_TRI)->clustering[v];
+    probe_end(g, &p);
+    return c;
+}
+
+//------------------------------------------------------------------------------
+// Distância entre dois vértices
+
+int distancia(struct grafo *g, const char *u, const char *v) {
+    if (!g || g->streamed || !u || !v) return -1;
+    struct sonda p;
+    probe_begin(g, &p, FASE_DISTANCIA);
+    struct analise *a = analysis(g, 0);
+    int s = find_vertex_index(g, u), t = find_vertex_index(g, v), d = -1;
+    if (s >= 0 && t >= 0) {
+        struct alt_ws *w = alt_ws_take(a);
+        d = alt_distance(g, a, w, s, t);
+        alt_ws_put(a, w);
+    }
+    probe_end(g, &p);
+    return d;
+}
+
+unsigned int prepara_distancias(struct grafo *g, unsigned int n_marcos) {
+    if (!g || g->streamed) return 0;
+    if (n_marcos == 0) n_marcos = ALT_DEFAULT;
+    if (n_marcos > ALT_MAX) n_marcos = ALT_MAX;
+    struct sonda p;
+    probe_begin(g, &p, FASE_PREPARA_DISTANCIAS);
+    struct analise *a = analysis(g, AN_COMP);
+    build_landmarks(g, a, (int)n_marcos);
+    calibrate_landmarks(g, a);
+    a->has_alt = 1;
+    probe_end(g, &p);
+    return 1;
+}
+
+unsigned int salva_indice_distancias(struct grafo *g, const char *caminho) {
+    if (!g || g->streamed || !caminho) return 0;
+    struct sonda p;
+    probe_begin(g, &p, FASE_SALVA_INDICE_DISTANCIAS);
+    struct analise *a = analysis(g, 0);
+    unsigned int ok = a->has_alt ? write_landmarks(g, a, caminho) : 0;
+    probe_end(g, &p);
+    return ok;
+}
+
+unsigned int carrega_indice_distancias(struct grafo *g, const char *caminho) {
+    if (!g || g->streamed || !caminho) return 0;
+    struct sonda p;
+    probe_begin(g, &p, FASE_CARREGA_INDICE_DISTANCIAS);
+    struct analise *a = analysis(g, 0);
+    unsigned int ok = read_landmarks(g, a, caminho);
+    if (ok) a->has_alt = 1;
+    probe_end(g, &p);
+    return ok;
+}
+
+//------------------------------------------------------------------------------
+unsigned int analisa_grafo(struct grafo *g) {
+    if (!g || g->streamed) return 0;
+    struct sonda p;
+    probe_begin(g, &p, FASE_ANALISA_GRAFO);
+    analysis(g, AN_COMP | AN_DFS | AN_COLOR);
+    component_diameters(g);
+    probe_end(g, &p);
+    return 1;
 }
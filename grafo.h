@@ -5,27 +5,77 @@
 
 
 /**
- * Estrutura de dados para representar um nó na lista de adjacência.
- * Cada nó contém o índice do vértice adjacente, o peso da aresta
- * e um ponteiro para o próximo nó na lista.
+ * Aresta lida da entrada, guardada até a montagem da adjacência.
+ * Contém os índices dos dois extremos e o peso da aresta.
  */
-typedef struct adj_node {
+typedef struct edge_rec {
+    int u;
     int v;
     int weight;
-    struct adj_node *next;
-} adj_node;
+} edge_rec;
+
+/**
+ * Posição da tabela hash de nomes. Guarda o hash do nome junto com o
+ * índice do vértice para que a sondagem só compare strings quando os
+ * hashes coincidem.
+ */
+typedef struct name_slot {
+    unsigned int hash;
+    int idx;              // índice do vértice ou -1 se a posição está livre
+} name_slot;
+
+/**
+ * Tabela de nomes dos vértices ("interning").
+ * Os nomes ficam um após o outro, terminados em '\0', em um pool contíguo;
+ * a busca por nome usa endereçamento aberto com sondagem linear.
+ */
+typedef struct name_table {
+    char *pool;           // nomes dos vértices
+    size_t pool_len;
+    size_t pool_cap;
+    size_t *offset;       // offset[i] = início do nome do vértice i em pool
+    int cap;              // capacidade de offset
+    name_slot *slots;
+    unsigned int n_slots; // potência de 2
+} name_table;
 
 /**
  * Estrutura de dados para representar um grafo.
  * Contém o nome do grafo, número de vértices, número de arestas,
- * array de nomes dos vértices e listas de adjacência.
+ * tabela de nomes dos vértices e a adjacência em formato CSR
+ * (compressed sparse row): os vizinhos do vértice u são
+ * adj[adj_off[u]] ... adj[adj_off[u + 1] - 1], com os pesos
+ * correspondentes em adj_w. Se todos os pesos são 1, adj_w é NULL; com
+ * define_compressao, os vizinhos ficam codificados em adj_z e adj é NULL.
  */
+struct arena;
+struct analise;
+struct conjuntos;
+
 struct grafo {
+    struct arena *mem;    // arena de onde vêm todas as alocações do grafo
     char *name;
     int n_vertices;
     int n_arestas;
-    char **vertices;      // array de nomes de vértice
-    adj_node **adj;       // listas de adjacência
+    name_table names;     // nomes de vértice e índice nome -> vértice
+    edge_rec *edges;      // arestas ainda fora do CSR, liberadas ao montá-lo
+    int n_edges;
+    int edges_cap;
+    unsigned int *adj_off; // n_vertices + 1 deslocamentos em adj
+    int *adj;             // vizinhos de todos os vértices, contíguos
+    int *adj_w;           // pesos, paralelos a adj (NULL se todos são 1)
+    unsigned char *adj_z; // vizinhos comprimidos (veja define_compressao) ou NULL
+    size_t *adj_zoff;     // n_vertices + 1 deslocamentos em adj_z
+    int n_csr;            // vértices cobertos por adj_off
+    int n_removed;        // entradas de adj removidas (-1) ainda não descartadas
+    int unit_weights;     // 1 se todo peso é 1, 0 se não, -1 se não verificado
+    void *map_base;       // imagem binária mapeada (ou NULL)
+    size_t map_size;
+    unsigned long versao; // incrementada a cada mudança no grafo
+    unsigned long n_buscas; // buscas feitas no último cálculo dos diâmetros
+    struct analise *cache; // resultados de análise, calculados sob demanda
+    struct conjuntos *uf; // componentes mantidos durante as mudanças (ou NULL)
+    int streamed;         // lido por le_grafo_stream: sem arestas guardadas
 };
 
 /**
@@ -35,6 +85,219 @@ struct grafo {
  */
 struct grafo *le_grafo(FILE *f);
 
+/**
+ * Lê um grafo de um arquivo no mesmo formato aceito por le_grafo.
+ * O arquivo é mapeado em memória e analisado em paralelo (veja
+ * define_threads); o grafo resultante, inclusive a numeração dos vértices,
+ * é idêntico ao produzido por le_grafo.
+ * @param caminho caminho do arquivo
+ * @return ponteiro para a estrutura do grafo lido ou NULL se o arquivo não
+ *         puder ser aberto
+ */
+struct grafo *le_grafo_arquivo(const char *caminho);
+
+
+/**
+ * Lê um grafo no formato de le_grafo guardando apenas os nomes dos vértices
+ * e conjuntos disjuntos com paridade: a memória é proporcional ao número de
+ * vértices, não ao de arestas, e n_vertices, n_arestas, n_componentes e
+ * bipartido ficam prontos ao fim da leitura. adiciona_vertice e
+ * adiciona_aresta continuam disponíveis. As consultas que precisam das
+ * arestas (diâmetros, vértices e arestas de corte, blocos, imagem binária,
+ * remove_aresta) devolvem NULL ou 0 para um grafo lido assim.
+ * @param f arquivo de onde o grafo será lido
+ * @return ponteiro para a estrutura do grafo lido ou NULL se f for NULL
+ */
+struct grafo *le_grafo_stream(FILE *f);
+
+/**
+ * Estatísticas da memória ocupada por um grafo.
+ */
+struct grafo_memoria {
+    size_t reservado;         // bytes obtidos do sistema
+    size_t usado;             // bytes em uso pelas estruturas do grafo
+    unsigned int blocos;      // blocos obtidos do sistema
+    unsigned long alocacoes;  // alocações feitas na arena do grafo
+};
+
+/**
+ * Preenche m com as estatísticas de memória do grafo g.
+ * @param g grafo
+ * @param m estrutura a ser preenchida
+ * @return 1 em caso de sucesso, 0 se g ou m for NULL
+ */
+unsigned int memoria_grafo(struct grafo *g, struct grafo_memoria *m);
+
+/**
+ * Totais medidos de uma função pública (veja define_instrumentacao).
+ */
+struct grafo_fase {
+    const char *funcao;       // nome da função em grafo.h
+    unsigned long chamadas;
+    double segundos;          // tempo de parede somado
+    unsigned long alocacoes;  // alocações na arena do grafo
+    unsigned long long bytes; // bytes alocados na arena do grafo
+    unsigned long long vertices; // vértices visitados
+    unsigned long long arestas;  // arestas examinadas (cada sentido conta)
+    unsigned long long buscas;   // buscas de caminhos mínimos
+    unsigned long long operacoes_heap; // inserções, remoções e decrease-key
+};
+
+/**
+ * Liga ou desliga a instrumentação. Ligada, cada função de grafo.h que lê,
+ * grava, modifica ou analisa um grafo soma a totais por função o tempo gasto,
+ * as alocações feitas na arena e o que seus algoritmos percorreram; os
+ * acessores de custo constante (nome, n_vertices, n_arestas, nome_vertice,
+ * memoria_grafo, buscas_diametros) e as funções de configuração não são
+ * medidos. Desligada (o padrão), não há medição alguma. Sem chamada a esta
+ * função, a instrumentação é ligada se a variável de ambiente
+ * GRAFO_INSTRUMENTACAO tiver valor diferente de 0.
+ * Os totais são do processo todo, somados de forma segura entre threads.
+ * @param ativa 1 para ligar, 0 para desligar
+ */
+void define_instrumentacao(unsigned int ativa);
+
+/**
+ * Copia os totais das funções já chamadas com a instrumentação ligada.
+ * @param fases vetor a preencher (pode ser NULL para só contar)
+ * @param max número de posições em fases
+ * @return número de funções com totais (pode ser maior que max)
+ */
+unsigned int le_instrumentacao(struct grafo_fase *fases, unsigned int max);
+
+/**
+ * Zera os totais da instrumentação.
+ */
+void zera_instrumentacao(void);
+
+/**
+ * Escreve em f os totais da instrumentação como um objeto JSON
+ * {"fases": [{"funcao": ..., "chamadas": ..., "segundos": ..., ...}, ...]}.
+ * @param f arquivo de saída
+ * @return 1 em caso de sucesso, 0 se f for NULL ou houver erro de escrita
+ */
+unsigned int escreve_instrumentacao(FILE *f);
+
+/**
+ * Procura um vértice pelo nome.
+ * @param g grafo a ser pesquisado
+ * @param nome nome do vértice
+ * @return índice do vértice (entre 0 e n_vertices(g) - 1) ou -1 se não existir
+ */
+int indice_vertice(struct grafo *g, const char *nome);
+
+/**
+ * Devolve o nome do vértice de índice i.
+ * @param g grafo
+ * @param i índice do vértice
+ * @return nome do vértice ou NULL se g for NULL ou i for inválido
+ */
+const char *nome_vertice(struct grafo *g, int i);
+
+/**
+ * Adiciona a g um vértice com o nome dado, se ainda não existir.
+ * O número de componentes e a bipartição passam a ser mantidos a cada
+ * mudança, de modo que n_componentes e bipartido não percorrem o grafo
+ * de novo; as demais consultas recalculam o que precisam na próxima chamada.
+ * Um grafo carregado com carrega_grafo_binario é copiado para a memória na
+ * primeira mudança.
+ * @param g grafo a ser modificado
+ * @param nome nome do vértice (não vazio)
+ * @return índice do vértice ou -1 se g ou nome for NULL ou nome for vazio
+ */
+int adiciona_vertice(struct grafo *g, const char *nome);
+
+/**
+ * Adiciona a g uma aresta entre os vértices u e v, criando-os se não
+ * existirem, como uma linha "u -- v peso" da entrada. O custo de manter
+ * componentes e bipartição é quase constante por aresta.
+ * @param g grafo a ser modificado
+ * @param u nome de um extremo
+ * @param v nome do outro extremo
+ * @param peso peso da aresta (>= 0)
+ * @return 1 em caso de sucesso, 0 se algum argumento for inválido
+ */
+unsigned int adiciona_aresta(struct grafo *g, const char *u, const char *v, int peso);
+
+/**
+ * Remove de g uma aresta entre u e v (uma só, se houver arestas paralelas).
+ * Uma remoção pode separar componentes, então a primeira consulta seguinte
+ * a n_componentes ou bipartido volta a percorrer o grafo.
+ * @param g grafo a ser modificado
+ * @param u nome de um extremo
+ * @param v nome do outro extremo
+ * @return 1 se uma aresta foi removida, 0 se não existir ou g for NULL
+ */
+unsigned int remove_aresta(struct grafo *g, const char *u, const char *v);
+
+/**
+ * Define o número de threads usado pelas funções que trabalham em paralelo:
+ * le_grafo_arquivo, n_componentes (e as consultas que dependem dos
+ * componentes), bipartido, diametros, n_triangulos e os coeficientes de
+ * agrupamento e, com BICONEXIDADE_PARALELA, vertices_corte, arestas_corte e
+ * n_blocos. Grafos pequenos são tratados por uma thread só. Com n = 0 o
+ * número volta a ser automático: a variável de ambiente GRAFO_THREADS ou o
+ * número de processadores. Os resultados não dependem do número de threads.
+ * @param n número de threads
+ */
+void define_threads(unsigned int n);
+
+/**
+ * Liga ou desliga a compressão da adjacência dos grafos montados daí em
+ * diante. Comprimida, a lista de vizinhos de cada vértice fica em ordem
+ * crescente e é guardada como diferenças entre vizinhos consecutivos, em
+ * 1 a 5 bytes cada, em vez de 4 bytes por vizinho; as análises leem a forma
+ * comprimida diretamente, um pouco mais devagar. Os resultados não mudam.
+ * Remover uma aresta descomprime a adjacência até a próxima consulta, e a
+ * imagem binária é sempre gravada sem compressão.
+ * @param ativa 1 para comprimir, 0 para não comprimir (padrão)
+ */
+void define_compressao(unsigned int ativa);
+
+/**
+ * Ordens de numeração dos vértices (veja define_reordenacao).
+ */
+#define REORDENACAO_NENHUMA 0u  // ordem de aparição na entrada (padrão)
+#define REORDENACAO_RCM     1u  // Cuthill–McKee reversa
+#define REORDENACAO_GRAU    2u  // grau decrescente
+
+/**
+ * Escolhe como le_grafo e le_grafo_arquivo numeram os vértices dos grafos
+ * lidos daí em diante. REORDENACAO_RCM dá números próximos a vértices
+ * próximos no grafo, o que melhora o uso da cache nos percursos e, com
+ * define_compressao, encurta as diferenças entre vizinhos;
+ * REORDENACAO_GRAU agrupa no começo os vértices de maior grau. A
+ * renumeração custa algumas passadas pelo grafo na leitura. Os nomes
+ * acompanham os vértices e os resultados das consultas não mudam; só
+ * indice_vertice e nome_vertice refletem a nova numeração. Uma imagem
+ * binária guarda a numeração do grafo gravado.
+ * @param ordem REORDENACAO_NENHUMA, REORDENACAO_RCM ou REORDENACAO_GRAU
+ */
+void define_reordenacao(unsigned int ordem);
+
+/**
+ * Grava uma imagem binária do grafo, que pode ser recarregada rapidamente
+ * com carrega_grafo_binario. A imagem é versionada, tem checksum e usa a
+ * ordem de bytes e o tamanho de palavra da máquina que a gravou.
+ * @param g grafo a ser gravado
+ * @param caminho caminho do arquivo a ser criado
+ * @return 1 em caso de sucesso, 0 em caso de erro
+ */
+unsigned int salva_grafo_binario(struct grafo *g, const char *caminho);
+
+/**
+ * Carrega um grafo gravado por salva_grafo_binario. O arquivo é mapeado em
+ * memória e usado diretamente, sem cópia. São sempre validados o cabeçalho
+ * e a estrutura das seções por vértice (tabela de nomes e início das listas
+ * de vizinhos), em tempo proporcional ao número de vértices; se verifica for
+ * diferente de 0, também o checksum de todo o conteúdo e os extremos de
+ * todas as arestas.
+ * @param caminho caminho do arquivo
+ * @param verifica se diferente de 0, confere o checksum e as arestas
+ * @return ponteiro para o grafo ou NULL se o arquivo não puder ser lido ou
+ *         não for uma imagem válida
+ */
+struct grafo *carrega_grafo_binario(const char *caminho, unsigned int verifica);
 
 /**
  * Destrói o grafo e libera toda a memória alocada.
@@ -87,6 +350,41 @@ unsigned int n_componentes(struct grafo *g);
  */
 char *diametros(struct grafo *g);
 
+/**
+ * Escreve em f os diâmetros dos componentes conexos de g, no mesmo formato
+ * de diametros, sem montar a string em memória.
+ * @param g grafo a ser analisado
+ * @param f arquivo de saída
+ * @return 1 em caso de sucesso, 0 se g ou f for NULL ou houver erro de escrita
+ */
+unsigned int escreve_diametros(struct grafo *g, FILE *f);
+
+/**
+ * Estratégias de cálculo dos diâmetros (veja define_estrategia_diametros).
+ */
+#define DIAMETRO_LIMITES   0u  // limites de excentricidade (padrão)
+#define DIAMETRO_EXAUSTIVO 1u  // uma busca a partir de cada vértice
+
+/**
+ * Escolhe a estratégia usada por diametros. Com DIAMETRO_LIMITES cada
+ * componente é resolvido por limites inferiores e superiores das
+ * excentricidades, o que costuma exigir poucas buscas; os vértices que os
+ * limites não resolverem após um número fixo de buscas são examinados
+ * exaustivamente. DIAMETRO_EXAUSTIVO faz uma busca a partir de cada vértice.
+ * O resultado é o mesmo com qualquer estratégia.
+ * @param estrategia DIAMETRO_LIMITES ou DIAMETRO_EXAUSTIVO
+ */
+void define_estrategia_diametros(unsigned int estrategia);
+
+/**
+ * Devolve o número de buscas de caminhos mínimos feitas no último cálculo
+ * dos diâmetros de g. Os diâmetros ficam guardados no grafo, então chamadas
+ * seguintes de diametros com a mesma estratégia não fazem novas buscas.
+ * @param g grafo
+ * @return número de buscas ou 0 se g for NULL
+ */
+unsigned long buscas_diametros(struct grafo *g);
+
 /**
  * Devolve uma string com os vértices de corte do grafo g em ordem alfabética.
  * Cada vértice é representado pelo seu nome.
@@ -95,6 +393,25 @@ char *diametros(struct grafo *g);
  */
 char *vertices_corte(struct grafo *g);
 
+/**
+ * Escreve em f os vértices de corte de g, no mesmo formato de vertices_corte,
+ * sem montar a string em memória.
+ * @param g grafo a ser analisado
+ * @param f arquivo de saída
+ * @return 1 em caso de sucesso, 0 se g ou f for NULL ou houver erro de escrita
+ */
+unsigned int escreve_vertices_corte(struct grafo *g, FILE *f);
+
+/**
+ * Devolve o número de blocos (componentes biconexas) de g. Vértices isolados
+ * não formam blocos; arestas paralelas contam como uma só.
+ * Os vértices de corte, as pontes e os blocos são calculados junto com os
+ * componentes e a bipartição, em uma única busca (veja analisa_grafo).
+ * @param g grafo a ser analisado
+ * @return número de blocos ou 0 se g for NULL
+ */
+unsigned int n_blocos(struct grafo *g);
+
 /**
  * Devolve uma string com as arestas de corte do grafo g em ordem alfabética.
  * Cada aresta é representada por um par de nomes de vértices em ordem alfabética.
@@ -103,4 +420,140 @@ char *vertices_corte(struct grafo *g);
  */
 char *arestas_corte(struct grafo *g);
 
+/**
+ * Escreve em f as arestas de corte de g, no mesmo formato de arestas_corte,
+ * sem montar a string em memória.
+ * @param g grafo a ser analisado
+ * @param f arquivo de saída
+ * @return 1 em caso de sucesso, 0 se g ou f for NULL ou houver erro de escrita
+ */
+unsigned int escreve_arestas_corte(struct grafo *g, FILE *f);
+
+/**
+ * Estratégias de cálculo dos vértices de corte, pontes e blocos (veja
+ * define_estrategia_biconexidade).
+ */
+#define BICONEXIDADE_SEQUENCIAL 0u  // busca em profundidade (padrão)
+#define BICONEXIDADE_PARALELA   1u  // Tarjan–Vishkin, com várias threads
+
+/**
+ * Escolhe como vertices_corte, arestas_corte e n_blocos são calculados.
+ * BICONEXIDADE_PARALELA usa o algoritmo de Tarjan e Vishkin sobre a árvore
+ * de uma busca em largura, com as threads de define_threads; faz mais
+ * trabalho que a busca em profundidade e só compensa em grafos grandes com
+ * vários núcleos. Grafos pequenos e execuções com uma única thread usam
+ * sempre a busca em profundidade. O resultado é o mesmo com qualquer
+ * estratégia.
+ * @param estrategia BICONEXIDADE_SEQUENCIAL ou BICONEXIDADE_PARALELA
+ */
+void define_estrategia_biconexidade(unsigned int estrategia);
+
+/**
+ * Devolve o número de triângulos de g. Laços não formam triângulos e arestas
+ * paralelas contam como uma só. A contagem custa O(m^1.5), usa as threads de
+ * define_threads em grafos grandes e fica guardada no grafo junto com os
+ * coeficientes de agrupamento, até que o grafo mude.
+ * @param g grafo a ser analisado
+ * @return número de triângulos ou 0 se g for NULL
+ */
+unsigned long long n_triangulos(struct grafo *g);
+
+/**
+ * Devolve o coeficiente de agrupamento global (transitividade) de g: 3 vezes
+ * o número de triângulos dividido pelo número de caminhos de comprimento 2,
+ * no grafo sem laços nem arestas paralelas.
+ * @param g grafo a ser analisado
+ * @return coeficiente entre 0 e 1 (0 se não há caminhos de comprimento 2 ou
+ *         g for NULL)
+ */
+double coeficiente_agrupamento(struct grafo *g);
+
+/**
+ * Devolve a média dos coeficientes de agrupamento locais dos vértices de g
+ * (veja coeficiente_agrupamento_local), incluídos os de grau menor que 2.
+ * @param g grafo a ser analisado
+ * @return média entre 0 e 1 ou 0 se g for NULL ou não tiver vértices
+ */
+double coeficiente_agrupamento_medio(struct grafo *g);
+
+/**
+ * Devolve o coeficiente de agrupamento local de um vértice: a fração dos
+ * pares de vizinhos distintos que são vizinhos entre si (0 se o vértice tem
+ * menos de 2 vizinhos distintos).
+ * @param g grafo a ser analisado
+ * @param nome nome do vértice
+ * @return coeficiente entre 0 e 1 ou -1 se o vértice não existir
+ */
+double coeficiente_agrupamento_local(struct grafo *g, const char *nome);
+
+/**
+ * Devolve a distância (soma dos pesos do caminho mínimo) entre os vértices
+ * u e v, por uma busca bidirecional que para assim que o caminho encontrado
+ * é comprovadamente mínimo. Com o índice de prepara_distancias ou
+ * carrega_indice_distancias, a busca pode ser guiada por limites
+ * inferiores tirados das distâncias aos marcos e visitar uma pequena parte
+ * do grafo.
+ * Cada chamada usa sua própria área de trabalho e só lê o grafo: depois de
+ * analisa_grafo (e da preparação do índice, se houver), várias threads
+ * podem chamar distancia ao mesmo tempo, junto com as consultas cujo
+ * resultado já está guardado.
+ * @param g grafo a ser consultado
+ * @param u nome de uma ponta
+ * @param v nome da outra ponta
+ * @return distância entre u e v ou -1 se não houver caminho, algum vértice
+ *         não existir ou g for NULL
+ */
+int distancia(struct grafo *g, const char *u, const char *v);
+
+/**
+ * Prepara o índice de marcos usado por distancia: escolhe n_marcos vértices
+ * bem espalhados, repartidos entre os maiores componentes, e guarda as
+ * distâncias de cada um a todos os vértices (n_marcos inteiros por
+ * vértice). Custa uma busca de caminhos mínimos por marco e algumas
+ * consultas de calibração, que decidem se os marcos guiam a busca: eles
+ * reduzem muito a busca em grafos de diâmetro grande, como grades e malhas
+ * viárias, mas não se pagam em grafos de diâmetro pequeno, em que a busca
+ * bidirecional comum já é curta. O índice fica no grafo até que ele mude.
+ * @param g grafo a ser indexado
+ * @param n_marcos número de marcos, até 64 (0 para o padrão, 16)
+ * @return 1 em caso de sucesso, 0 se g for NULL
+ */
+unsigned int prepara_distancias(struct grafo *g, unsigned int n_marcos);
+
+/**
+ * Grava o índice de marcos de g, para que carrega_indice_distancias o
+ * recupere sem refazer as buscas. O arquivo usa a ordem de bytes da máquina
+ * que o gravou.
+ * @param g grafo com índice preparado
+ * @param caminho caminho do arquivo a ser criado
+ * @return 1 em caso de sucesso, 0 se g não tiver índice ou houver erro
+ */
+unsigned int salva_indice_distancias(struct grafo *g, const char *caminho);
+
+/**
+ * Carrega um índice gravado por salva_indice_distancias. O índice só é
+ * aceito se foi gravado para um grafo com os mesmos vértices, na mesma
+ * numeração, e as mesmas arestas e pesos que g.
+ * @param g grafo
+ * @param caminho caminho do arquivo
+ * @return 1 em caso de sucesso, 0 se o arquivo não puder ser lido ou não
+ *         for um índice de g
+ */
+unsigned int carrega_indice_distancias(struct grafo *g, const char *caminho);
+
+/**
+ * Calcula de uma vez tudo o que as consultas de análise usam: componentes,
+ * bipartição, vértices de corte, pontes e blocos em uma única busca em
+ * profundidade, e os diâmetros a partir dos componentes encontrados.
+ * Os resultados ficam guardados no grafo e são reaproveitados por
+ * n_componentes, bipartido, diametros, vertices_corte, arestas_corte e
+ * n_blocos até que o grafo mude. Chamar esta função é opcional: cada
+ * consulta calcula sob demanda apenas o que ainda falta. Calcular e guardar
+ * resultados é exclusivo, mas consultar os já guardados só lê o grafo, e
+ * essas consultas podem ser feitas por várias threads ao mesmo tempo.
+ * @param g grafo a ser analisado
+ * @return 1 em caso de sucesso, 0 se g for NULL
+ */
+unsigned int analisa_grafo(struct grafo *g);
+
 #endif
@@ -1,28 +1,891 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <dirent.h>
+#include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 #include "grafo.h"
 
 //------------------------------------------------------------------------------
-int main(void) {
+// Uso: teste [-s] [-p] [-z] [-a] [-o ordem] [-b imagem] [-t threads]
+//            [-j medidas] [--stream] [arquivo]
+//      teste [-p] [-z] [-o ordem] [-t threads] --servidor[=soquete]
+//      teste [-s] [-p] [-z] [-a] [-o ordem] [-t threads] [-j medidas]
+//            [--stream] --lote [caminho ...]
+//
+// Lê o grafo da entrada padrão ou, se dado, do arquivo (mapeado em memória
+// e analisado em paralelo) e imprime suas propriedades.
+//   -s         o arquivo é uma imagem binária gravada com -b
+//   -b imagem  grava a imagem binária do grafo lido em vez de analisá-lo
+//   -t threads número de threads das funções paralelas (padrão: automático)
+//   -p         calcula vértices de corte, pontes e blocos em paralelo
+//              (BICONEXIDADE_PARALELA)
+//   -z         comprime a adjacência dos grafos lidos (define_compressao)
+//   -a         acrescenta ao relatório os triângulos e os coeficientes de
+//              agrupamento global e médio
+//   -o ordem   renumera os vértices ao ler: rcm, grau ou nenhuma (padrão)
+//              (define_reordenacao)
+//   -j medidas liga a instrumentação e, ao final, grava em medidas ("-" para
+//              a saída padrão) o JSON com tempo e contadores de cada função
+//   --stream   lê em fluxo (le_grafo_stream), com memória proporcional ao
+//              número de vértices, e imprime só contagens, componentes e
+//              bipartição
+//   --servidor responde pedidos na entrada padrão ou no soquete Unix dado
+//              (veja o modo servidor abaixo); -t dá também o número de
+//              threads que atendem os pedidos
+//   --lote     analisa vários arquivos, cada caminho um arquivo ou um
+//              diretório (veja o modo lote abaixo); -t dá o número de
+//              arquivos analisados ao mesmo tempo
+static void uso(void) {
+  fprintf(stderr, "uso: teste [-s] [-p] [-z] [-a] [-o ordem] [-b imagem] [-t threads]\n"
+                  "           [-j medidas] [--stream] [arquivo]\n"
+                  "     teste [-p] [-z] [-o ordem] [-t threads] --servidor[=soquete]\n"
+                  "     teste [-s] [-p] [-z] [-a] [-o ordem] [-t threads] [-j medidas]\n"
+                  "           [--stream] --lote [caminho ...]\n");
+  exit(2);
+}
+
+//------------------------------------------------------------------------------
+// Grava em medidas, se dado, as medidas da instrumentação. Devolve 0 em caso
+// de erro.
+static int grava_medidas(const char *medidas) {
+  int ok = 1;
+  if (medidas) {
+    FILE *f = strcmp(medidas, "-") ? fopen(medidas, "w") : stdout;
+    if (!f || !escreve_instrumentacao(f)) {
+      fprintf(stderr, "teste: não foi possível gravar %s\n", medidas);
+      ok = 0;
+    }
+    if (f && f != stdout && fclose(f) != 0) ok = 0;
+  }
+  return ok;
+}
+
+// Destrói o grafo e, se pedido, grava as medidas da instrumentação.
+// Devolve o código de saída do programa.
+static int termina(struct grafo *g, const char *medidas) {
+  unsigned int ok = destroi_grafo(g);
+  if (!grava_medidas(medidas)) ok = 0;
+  return !ok;
+}
+
+// Lê o grafo do arquivo (ou da entrada padrão, se arquivo é NULL) do jeito
+// pedido pelas opções
+static struct grafo *le(const char *arquivo, int binario, int fluxo) {
+  struct grafo *g;
+  if (fluxo) {
+    FILE *f = arquivo ? fopen(arquivo, "r") : stdin;
+    g = f ? le_grafo_stream(f) : NULL;
+    if (f && f != stdin) fclose(f);
+  } else if (binario)
+    g = carrega_grafo_binario(arquivo, 1);
+  else
+    g = arquivo ? le_grafo_arquivo(arquivo) : le_grafo(stdin);
+  return g;
+}
+
+// Relatório com triângulos e agrupamento (-a)
+static int agrupamento;
+
+// Escreve em f as propriedades do grafo; em fluxo, só as que le_grafo_stream
+// permite calcular
+static void relata(FILE *f, struct grafo *g, int fluxo) {
+  fprintf(f, "grafo: %s\n", nome(g));
+  fprintf(f, "%d vertices\n", n_vertices(g));
+  fprintf(f, "%d arestas\n", n_arestas(g));
+  fprintf(f, "%d componentes\n", n_componentes(g));
+
+  fprintf(f, "%sbipartido\n", bipartido(g) ? "" : "não ");
+  if (fluxo) return;
+
+  fprintf(f, "diâmetros: ");
+  escreve_diametros(g, f);
+  fprintf(f, "\nvértices de corte: ");
+  escreve_vertices_corte(g, f);
+  fprintf(f, "\narestas de corte: ");
+  escreve_arestas_corte(g, f);
+  fprintf(f, "\n");
+  if (!agrupamento) return;
+
+  fprintf(f, "%llu triângulos\n", n_triangulos(g));
+  fprintf(f, "agrupamento: %.6f global, %.6f médio\n",
+          coeficiente_agrupamento(g), coeficiente_agrupamento_medio(g));
+}
+
+//------------------------------------------------------------------------------
+// Modo servidor: teste --servidor [soquete]
+//
+// Carrega grafos uma única vez e responde consultas sobre eles, um pedido
+// por linha, na entrada padrão ou, se dado, em um soquete Unix (uma conexão
+// por cliente). Pedidos:
+//   carrega NOME ARQUIVO          lê ARQUIVO com le_grafo_arquivo
+//   carrega_binario NOME IMAGEM   carrega uma imagem gravada com -b
+//   descarta NOME
+//   grafos                        nomes dos grafos carregados
+//   CONSULTA NOME                 nome, vertices, arestas, componentes,
+//                                 bipartido, diametros, vertices_corte,
+//                                 arestas_corte, blocos, triangulos,
+//                                 agrupamento ou agrupamento_medio
+//   distancia NOME U V            distância entre os vértices U e V (-1 se
+//                                 não há caminho ou um deles não existe)
+//   marcos NOME K [ARQUIVO]       prepara o índice de marcos de distancia
+//                                 com K marcos (0: o padrão); com ARQUIVO,
+//                                 carrega o índice gravado nele se for deste
+//                                 grafo e, senão, o constrói e grava
+//   adiciona_vertice NOME V       mudanças no grafo carregado (adiciona_vertice,
+//   adiciona_aresta NOME U V [P]  adiciona_aresta e remove_aresta); a resposta
+//   remove_aresta NOME U V        é o valor devolvido pela função
+//   sai                           encerra a conexão
+// Cada pedido recebe uma linha "ok RESULTADO" ou "erro MENSAGEM", na ordem
+// dos pedidos. As consultas são atendidas em paralelo por um conjunto de
+// threads e cada resposta sai assim que as anteriores saíram, então o
+// cliente pode mandar vários pedidos sem esperar pelas respostas. Carregar e
+// descartar grafos é feito na ordem de leitura, antes dos pedidos seguintes.
+//
+// A biblioteca guarda no grafo os resultados das análises, o que duas
+// threads não podem fazer ao mesmo tempo, mas consultar um resultado já
+// guardado só lê o grafo. Ao carregar um grafo, analisa_grafo calcula o que
+// quase todas as consultas usam; depois disso, cada grafo tem uma trava de
+// leitura e escrita: consultas cujo resultado já está guardado (e distancia)
+// rodam juntas com a trava de leitura, e só a primeira consulta de
+// triângulos e agrupamento, o pedido marcos e as mudanças, que calculam ou
+// guardam algo, tomam a trava de escrita. Uma mudança descarta os
+// resultados guardados, que a próxima consulta calcula de novo.
+
+// Grafo carregado
+typedef struct carregado {
+  char *nome;
+  struct grafo *g;
+  pthread_rwlock_t trava;      // leitura: consultas já calculadas; escrita: calcular
+  unsigned int prontas;        // grupos de consultas já calculados (PRONTA_*)
+  int refs;                    // consultas pendentes, mais 1 enquanto registrado
+  struct carregado *prox;
+} carregado;
+
+// Grupos de consultas cujos resultados ficam guardados no grafo
+#define PRONTA_ANALISE    1u   // analisa_grafo: componentes, blocos, diâmetros...
+#define PRONTA_TRIANGULOS 2u   // n_triangulos e agrupamento
+#define EXCLUSIVA         4u   // o pedido sempre escreve no grafo: trava de escrita
+#define MUDA              8u   // o pedido muda o grafo: descarta os resultados guardados
+
+// Argumentos de um pedido depois do nome do grafo
+#define N_ARGS 3
+
+static pthread_mutex_t trava_registro = PTHREAD_MUTEX_INITIALIZER;
+static carregado *registro;
+
+// Devolve o grafo de nome dado, com uma referência a mais, ou NULL
+static carregado *pega_grafo(const char *nome_grafo) {
+  pthread_mutex_lock(&trava_registro);
+  carregado *c = registro;
+  while (c && strcmp(c->nome, nome_grafo) != 0) c = c->prox;
+  if (c) c->refs++;
+  pthread_mutex_unlock(&trava_registro);
+  return c;
+}
+
+static void solta_grafo(carregado *c) {
+  pthread_mutex_lock(&trava_registro);
+  int fim = --c->refs == 0;
+  pthread_mutex_unlock(&trava_registro);
+  if (!fim) return;
+  destroi_grafo(c->g);
+  pthread_rwlock_destroy(&c->trava);
+  free(c->nome);
+  free(c);
+}
 
-  struct grafo *g = le_grafo(stdin);
+// Registra g, já analisado com analisa_grafo, com o nome dado; devolve 0,
+// destruindo g, se o nome já está em uso
+static int registra_grafo(const char *nome_grafo, struct grafo *g) {
+  carregado *c = malloc(sizeof(carregado));
+  char *nome_copia = malloc(strlen(nome_grafo) + 1);
+  if (!c || !nome_copia) exit(EXIT_FAILURE);
+  strcpy(nome_copia, nome_grafo);
+  c->nome = nome_copia;
+  c->g = g;
+  c->prontas = PRONTA_ANALISE;
+  c->refs = 1;
+  pthread_rwlock_init(&c->trava, NULL);
+  pthread_mutex_lock(&trava_registro);
+  carregado *p = registro;
+  while (p && strcmp(p->nome, nome_grafo) != 0) p = p->prox;
+  if (!p) {
+    c->prox = registro;
+    registro = c;
+  }
+  pthread_mutex_unlock(&trava_registro);
+  if (p) {
+    solta_grafo(c);             // destrói g
+    return 0;
+  }
+  return 1;
+}
+
+// Retira o grafo do registro; ele é destruído quando a última consulta
+// pendente terminar. Devolve 0 se não havia grafo com esse nome.
+static int descarta_grafo(const char *nome_grafo) {
+  pthread_mutex_lock(&trava_registro);
+  carregado **p = &registro;
+  while (*p && strcmp((*p)->nome, nome_grafo) != 0) p = &(*p)->prox;
+  carregado *c = *p;
+  if (c) *p = c->prox;
+  pthread_mutex_unlock(&trava_registro);
+  if (c) solta_grafo(c);
+  return c != NULL;
+}
+
+//------------------------------------------------------------------------------
+// Respostas
+
+// Monta uma resposta com formato de printf, terminada em fim de linha
+static char *responde(const char *formato, ...) __attribute__((format(printf, 1, 2)));
+
+static char *responde(const char *formato, ...) {
+  va_list ap;
+  va_start(ap, formato);
+  int n = vsnprintf(NULL, 0, formato, ap);
+  va_end(ap);
+  char *s = malloc((size_t)n + 2);
+  if (!s) exit(EXIT_FAILURE);
+  va_start(ap, formato);
+  vsnprintf(s, (size_t)n + 1, formato, ap);
+  va_end(ap);
+  s[n] = '\n';
+  s[n + 1] = '\0';
+  return s;
+}
+
+// Resposta de uma consulta (string devolvida pela biblioteca, liberada aqui)
+static char *responde_texto(char *texto) {
+  char *s = texto ? responde("ok %s", texto) : responde("erro consulta indisponível");
+  free(texto);
+  return s;
+}
+
+// Prepara o índice de marcos de g para o pedido "marcos"
+static char *marcos(struct grafo *g, const char *n_marcos, const char *arquivo) {
+  if (!n_marcos) return responde("erro uso: marcos NOME K [ARQUIVO]");
+  if (arquivo && carrega_indice_distancias(g, arquivo)) return responde("ok carregado");
+  prepara_distancias(g, (unsigned int)strtoul(n_marcos, NULL, 10));
+  if (arquivo && !salva_indice_distancias(g, arquivo))
+    return responde("erro não foi possível gravar %s", arquivo);
+  return responde("ok preparado");
+}
+
+// Grupos de que a consulta depende
+static unsigned int grupo_consulta(const char *pedido) {
+  static const char *const analise[] = {
+    "componentes", "bipartido", "blocos", "diametros", "vertices_corte",
+    "arestas_corte", "distancia", NULL
+  };
+  for (int i = 0; analise[i]; i++)
+    if (strcmp(pedido, analise[i]) == 0) return PRONTA_ANALISE;
+  if (strcmp(pedido, "triangulos") == 0 || strncmp(pedido, "agrupamento", 11) == 0)
+    return PRONTA_ANALISE | PRONTA_TRIANGULOS;
+  if (strcmp(pedido, "marcos") == 0) return EXCLUSIVA;
+  if (strcmp(pedido, "adiciona_vertice") == 0 || strcmp(pedido, "adiciona_aresta") == 0 ||
+      strcmp(pedido, "remove_aresta") == 0)
+    return EXCLUSIVA | MUDA;
+  return 0;
+}
+
+// Responde a consulta ao grafo g, com a trava já tomada
+static char *responde_consulta(struct grafo *g, const char *pedido, char *const args[N_ARGS]) {
+  char *s;
+  if (strcmp(pedido, "nome") == 0)                s = responde("ok %s", nome(g));
+  else if (strcmp(pedido, "vertices") == 0)       s = responde("ok %u", n_vertices(g));
+  else if (strcmp(pedido, "arestas") == 0)        s = responde("ok %u", n_arestas(g));
+  else if (strcmp(pedido, "componentes") == 0)    s = responde("ok %u", n_componentes(g));
+  else if (strcmp(pedido, "bipartido") == 0)      s = responde("ok %u", bipartido(g));
+  else if (strcmp(pedido, "blocos") == 0)         s = responde("ok %u", n_blocos(g));
+  else if (strcmp(pedido, "diametros") == 0)      s = responde_texto(diametros(g));
+  else if (strcmp(pedido, "vertices_corte") == 0) s = responde_texto(vertices_corte(g));
+  else if (strcmp(pedido, "arestas_corte") == 0)  s = responde_texto(arestas_corte(g));
+  else if (strcmp(pedido, "triangulos") == 0)     s = responde("ok %llu", n_triangulos(g));
+  else if (strcmp(pedido, "agrupamento") == 0)    s = responde("ok %.6f", coeficiente_agrupamento(g));
+  else if (strcmp(pedido, "agrupamento_medio") == 0)
+    s = responde("ok %.6f", coeficiente_agrupamento_medio(g));
+  else if (strcmp(pedido, "distancia") == 0)
+    s = args[1] ? responde("ok %d", distancia(g, args[0], args[1]))
+                : responde("erro uso: distancia NOME U V");
+  else if (strcmp(pedido, "marcos") == 0)         s = marcos(g, args[0], args[1]);
+  else if (strcmp(pedido, "adiciona_vertice") == 0)
+    s = args[0] ? responde("ok %d", adiciona_vertice(g, args[0]))
+                : responde("erro uso: adiciona_vertice NOME V");
+  else if (strcmp(pedido, "adiciona_aresta") == 0)
+    s = args[1] ? responde("ok %u", adiciona_aresta(g, args[0], args[1],
+                                                    args[2] ? atoi(args[2]) : 1))
+                : responde("erro uso: adiciona_aresta NOME U V [PESO]");
+  else if (strcmp(pedido, "remove_aresta") == 0)
+    s = args[1] ? responde("ok %u", remove_aresta(g, args[0], args[1]))
+                : responde("erro uso: remove_aresta NOME U V");
+  else                                            s = responde("erro pedido desconhecido: %s", pedido);
+  return s;
+}
+
+// Atende uma consulta ao grafo c; args são os argumentos depois do nome do
+// grafo (ou NULL). Com os resultados de que ela depende já guardados, basta
+// a trava de leitura; senão, a de escrita, sob a qual eles são calculados.
+static char *consulta(carregado *c, const char *pedido, char *const args[N_ARGS]) {
+  unsigned int grupo = grupo_consulta(pedido);
   char *s;
+  pthread_rwlock_rdlock(&c->trava);
+  if (!(grupo & EXCLUSIVA) && (c->prontas & grupo) == grupo) {
+    s = responde_consulta(c->g, pedido, args);
+    pthread_rwlock_unlock(&c->trava);
+    return s;
+  }
+  pthread_rwlock_unlock(&c->trava);
+  pthread_rwlock_wrlock(&c->trava);
+  if ((grupo & PRONTA_ANALISE) && !(c->prontas & PRONTA_ANALISE)) analisa_grafo(c->g);
+  if ((grupo & PRONTA_TRIANGULOS) && !(c->prontas & PRONTA_TRIANGULOS)) n_triangulos(c->g);
+  s = responde_consulta(c->g, pedido, args);
+  if (grupo & MUDA) c->prontas = 0;
+  else c->prontas |= grupo & (PRONTA_ANALISE | PRONTA_TRIANGULOS);
+  pthread_rwlock_unlock(&c->trava);
+  return s;
+}
+
+// Nomes dos grafos carregados, separados por espaço
+static char *lista_grafos(void) {
+  size_t len = 0;
+  pthread_mutex_lock(&trava_registro);
+  for (carregado *c = registro; c; c = c->prox) len += strlen(c->nome) + 1;
+  char *s = malloc(len + 1);
+  if (!s) exit(EXIT_FAILURE);
+  s[0] = '\0';
+  for (carregado *c = registro; c; c = c->prox) {
+    if (s[0]) strcat(s, " ");
+    strcat(s, c->nome);
+  }
+  pthread_mutex_unlock(&trava_registro);
+  return responde_texto(s);
+}
+
+//------------------------------------------------------------------------------
+// Conexões e threads de atendimento
+
+typedef struct conexao conexao;
+
+// Pedido de uma conexão
+typedef struct pedido {
+  conexao *con;
+  carregado *grafo;            // grafo consultado (com referência) ou NULL
+  char *consulta;              // nome da consulta
+  char *args[N_ARGS];          // argumentos depois do nome do grafo ou NULL
+  char *resposta;              // NULL enquanto não atendido
+  struct pedido *prox;         // próximo pedido da conexão
+  struct pedido *prox_fila;    // próximo na fila de atendimento
+} pedido;
+
+struct conexao {
+  FILE *saida;
+  pthread_mutex_t trava;
+  pthread_cond_t pronto;       // uma resposta ficou pronta ou a leitura terminou
+  pedido *primeiro, *ultimo;   // pedidos ainda não respondidos, em ordem
+  int fim;                     // não haverá mais pedidos
+};
+
+// Fila comum a todas as conexões
+static pthread_mutex_t trava_fila = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t tem_pedido = PTHREAD_COND_INITIALIZER;
+static pedido *fila_inicio, *fila_fim;
+
+static void conclui(pedido *p, char *resposta) {
+  conexao *con = p->con;
+  pthread_mutex_lock(&con->trava);
+  p->resposta = resposta;
+  pthread_cond_signal(&con->pronto);
+  pthread_mutex_unlock(&con->trava);
+}
+
+static void *atendente(void *arg) {
+  (void)arg;
+  for (;;) {
+    pthread_mutex_lock(&trava_fila);
+    while (!fila_inicio) pthread_cond_wait(&tem_pedido, &trava_fila);
+    pedido *p = fila_inicio;
+    fila_inicio = p->prox_fila;
+    if (!fila_inicio) fila_fim = NULL;
+    pthread_mutex_unlock(&trava_fila);
+    char *r = consulta(p->grafo, p->consulta, p->args);
+    solta_grafo(p->grafo);
+    conclui(p, r);
+  }
+  return NULL;
+}
+
+static void enfileira(pedido *p) {
+  pthread_mutex_lock(&trava_fila);
+  p->prox_fila = NULL;
+  if (fila_fim) fila_fim->prox_fila = p;
+  else fila_inicio = p;
+  fila_fim = p;
+  pthread_cond_signal(&tem_pedido);
+  pthread_mutex_unlock(&trava_fila);
+}
+
+// Escreve as respostas da conexão em ordem, até o fim dos pedidos
+static void *escritor(void *arg) {
+  conexao *con = arg;
+  int pendente = 0;              // há respostas escritas e não entregues
+  pthread_mutex_lock(&con->trava);
+  for (;;) {
+    pedido *p = con->primeiro;
+    if (!p && con->fim) break;
+    if (!p || !p->resposta) {
+      // Antes de esperar, entrega o que já foi escrito
+      if (pendente) {
+        pthread_mutex_unlock(&con->trava);
+        fflush(con->saida);
+        pendente = 0;
+        pthread_mutex_lock(&con->trava);
+      } else {
+        pthread_cond_wait(&con->pronto, &con->trava);
+      }
+      continue;
+    }
+    con->primeiro = p->prox;
+    if (!con->primeiro) con->ultimo = NULL;
+    pthread_mutex_unlock(&con->trava);
+    fputs(p->resposta, con->saida);
+    pendente = 1;
+    free(p->resposta);
+    free(p->consulta);
+    for (int i = 0; i < N_ARGS; i++) free(p->args[i]);
+    free(p);
+    pthread_mutex_lock(&con->trava);
+  }
+  pthread_mutex_unlock(&con->trava);
+  fflush(con->saida);
+  return NULL;
+}
+
+// Interpreta uma linha de pedido; as consultas vão para a fila, os demais
+// pedidos são atendidos aqui mesmo. Devolve 0 no pedido "sai".
+static int le_pedido(conexao *con, char *linha) {
+  char *resto;
+  char *cmd = strtok_r(linha, " \t\r\n", &resto);
+  char *arg1 = cmd ? strtok_r(NULL, " \t\r\n", &resto) : NULL;
+  char *arg2 = arg1 ? strtok_r(NULL, " \t\r\n", &resto) : NULL;
+  if (!cmd) return 1;
+  if (strcmp(cmd, "sai") == 0) return 0;
+
+  pedido *p = calloc(1, sizeof(pedido));
+  if (!p) exit(EXIT_FAILURE);
+  p->con = con;
+  char *r = NULL;
+  int binario = strcmp(cmd, "carrega_binario") == 0;
+  if (binario || strcmp(cmd, "carrega") == 0) {
+    struct grafo *g = NULL;
+    if (!arg2) r = responde("erro uso: %s NOME ARQUIVO", cmd);
+    else if (!(g = binario ? carrega_grafo_binario(arg2, 1) : le_grafo_arquivo(arg2)))
+      r = responde("erro não foi possível ler %s", arg2);
+    else {
+      analisa_grafo(g);
+      r = registra_grafo(arg1, g) ? responde("ok %s", arg1)
+          : responde("erro grafo já carregado: %s", arg1);
+    }
+  } else if (strcmp(cmd, "descarta") == 0) {
+    r = !arg1 ? responde("erro uso: descarta NOME")
+        : descarta_grafo(arg1) ? responde("ok %s", arg1)
+        : responde("erro grafo não carregado: %s", arg1);
+  } else if (strcmp(cmd, "grafos") == 0) {
+    r = lista_grafos();
+  } else if (!arg1) {
+    r = responde("erro uso: %s NOME", cmd);
+  } else if (!(p->grafo = pega_grafo(arg1))) {
+    r = responde("erro grafo não carregado: %s", arg1);
+  } else {
+    p->consulta = malloc(strlen(cmd) + 1);
+    if (!p->consulta) exit(EXIT_FAILURE);
+    strcpy(p->consulta, cmd);
+    for (int i = 0; i < N_ARGS && arg2; i++) {
+      if (!(p->args[i] = strdup(arg2))) exit(EXIT_FAILURE);
+      arg2 = strtok_r(NULL, " \t\r\n", &resto);
+    }
+  }
+
+  pthread_mutex_lock(&con->trava);
+  p->resposta = r;
+  if (con->ultimo) con->ultimo->prox = p;
+  else con->primeiro = p;
+  con->ultimo = p;
+  if (r) pthread_cond_signal(&con->pronto);
+  pthread_mutex_unlock(&con->trava);
+  if (!r) enfileira(p);
+  return 1;
+}
+
+// Atende os pedidos lidos de entrada, respondendo em saida, até o fim da
+// entrada ou o pedido "sai"
+static void atende_conexao(FILE *entrada, FILE *saida) {
+  conexao con;
+  memset(&con, 0, sizeof(con));
+  con.saida = saida;
+  pthread_mutex_init(&con.trava, NULL);
+  pthread_cond_init(&con.pronto, NULL);
+  pthread_t t;
+  if (pthread_create(&t, NULL, escritor, &con) != 0) exit(EXIT_FAILURE);
+
+  char *linha = NULL;
+  size_t cap = 0;
+  while (getline(&linha, &cap, entrada) > 0 && le_pedido(&con, linha)) {
+  }
+  free(linha);
+
+  pthread_mutex_lock(&con.trava);
+  con.fim = 1;
+  pthread_cond_signal(&con.pronto);
+  pthread_mutex_unlock(&con.trava);
+  pthread_join(t, NULL);
+  pthread_cond_destroy(&con.pronto);
+  pthread_mutex_destroy(&con.trava);
+}
+
+static void *cliente(void *arg) {
+  int fd = (int)(intptr_t)arg;
+  int fd_saida = dup(fd);
+  FILE *entrada = fdopen(fd, "r");
+  FILE *saida = fd_saida >= 0 ? fdopen(fd_saida, "w") : NULL;
+  if (entrada && saida) atende_conexao(entrada, saida);
+  if (entrada) fclose(entrada);
+  else close(fd);
+  if (saida) fclose(saida);
+  else if (fd_saida >= 0) close(fd_saida);
+  return NULL;
+}
+
+// Roda o servidor na entrada padrão ou no soquete Unix dado. Com soquete,
+// só termina em caso de erro.
+static int servidor(const char *soquete, unsigned int n_atendentes) {
+  signal(SIGPIPE, SIG_IGN);
+  for (unsigned int i = 0; i < n_atendentes; i++) {
+    pthread_t t;
+    if (pthread_create(&t, NULL, atendente, NULL) != 0) exit(EXIT_FAILURE);
+    pthread_detach(t);
+  }
+  if (!soquete) {
+    atende_conexao(stdin, stdout);
+    while (registro) descarta_grafo(registro->nome);
+    return 0;
+  }
+
+  struct sockaddr_un end;
+  memset(&end, 0, sizeof(end));
+  end.sun_family = AF_UNIX;
+  if (strlen(soquete) >= sizeof(end.sun_path)) {
+    fprintf(stderr, "teste: caminho do soquete muito longo: %s\n", soquete);
+    return 1;
+  }
+  strcpy(end.sun_path, soquete);
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  unlink(soquete);
+  if (fd < 0 || bind(fd, (struct sockaddr *)&end, sizeof(end)) != 0 || listen(fd, 64) != 0) {
+    perror("teste");
+    return 1;
+  }
+  for (;;) {
+    int c = accept(fd, NULL, NULL);
+    if (c < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) continue;
+      perror("teste");
+      return 1;
+    }
+    pthread_t t;
+    if (pthread_create(&t, NULL, cliente, (void *)(intptr_t)c) != 0) {
+      close(c);
+      continue;
+    }
+    pthread_detach(t);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Modo lote: teste --lote [caminho ...]
+//
+// Analisa muitos arquivos em um só processo. Cada caminho é um arquivo de
+// grafo ou um diretório, do qual são lidos os arquivos regulares em ordem de
+// nome; sem caminhos, lê a lista de arquivos da entrada padrão, um por
+// linha. Para cada arquivo escreve "arquivo: CAMINHO" seguido do mesmo
+// relatório do modo normal, ou de "erro: não foi possível ler".
+//
+// Os arquivos são distribuídos entre threads de trabalho, e cada uma escreve
+// o relatório do seu arquivo em um buffer próprio na memória. A thread
+// principal copia os buffers para a saída na ordem dos arquivos, então a
+// saída não depende da ordem em que as análises terminam. Para limitar a
+// memória, uma thread não começa um arquivo que esteja mais de JANELA_LOTE
+// relatórios por thread à frente do último escrito.
+//
+// Cada grafo é analisado por uma só thread: o paralelismo vem de analisar
+// vários arquivos ao mesmo tempo. A biblioteca não tem estado global além da
+// configuração e das medidas da instrumentação, que são somadas com
+// operações atômicas.
+
+#define JANELA_LOTE 4
+
+// Lista de caminhos
+typedef struct lista {
+  char **itens;
+  size_t n, cap;
+} lista;
+
+static void acrescenta(lista *l, const char *caminho) {
+  if (l->n == l->cap) {
+    l->cap = l->cap ? 2 * l->cap : 64;
+    l->itens = realloc(l->itens, l->cap * sizeof(char *));
+    if (!l->itens) exit(EXIT_FAILURE);
+  }
+  l->itens[l->n] = strdup(caminho);
+  if (!l->itens[l->n]) exit(EXIT_FAILURE);
+  l->n++;
+}
+
+static int compara_caminhos(const void *a, const void *b) {
+  return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// Acrescenta os arquivos regulares do diretório, em ordem de nome.
+// Devolve 0 se o diretório não pôde ser lido.
+static int acrescenta_diretorio(lista *l, const char *dir) {
+  DIR *d = opendir(dir);
+  if (!d) return 0;
+  size_t inicio = l->n;
+  size_t len = strlen(dir);
+  char *caminho = NULL;
+  struct dirent *e;
+  while ((e = readdir(d))) {
+    if (e->d_name[0] == '.') continue;
+    caminho = realloc(caminho, len + strlen(e->d_name) + 2);
+    if (!caminho) exit(EXIT_FAILURE);
+    sprintf(caminho, "%s/%s", dir, e->d_name);
+    struct stat st;
+    if (stat(caminho, &st) == 0 && S_ISREG(st.st_mode)) acrescenta(l, caminho);
+  }
+  free(caminho);
+  closedir(d);
+  qsort(l->itens + inicio, l->n - inicio, sizeof(char *), compara_caminhos);
+  return 1;
+}
+
+typedef struct lote_trabalho {
+  char **arquivos;
+  size_t n;
+  int binario, fluxo;
+  size_t janela;               // relatórios prontos e não escritos, no máximo
+  pthread_mutex_t trava;
+  pthread_cond_t mudou;        // um relatório ficou pronto ou foi escrito
+  size_t proximo;              // próximo arquivo a analisar
+  size_t escritos;             // relatórios já escritos
+  char **relatorios;           // relatório de cada arquivo; NULL se não pronto
+  size_t *tamanhos;
+  int falhas;
+} lote_trabalho;
+
+// Analisa o arquivo e devolve o relatório em *tam bytes; *ok recebe 0 se o
+// arquivo não pôde ser lido
+static char *analisa_arquivo(lote_trabalho *l, const char *arquivo, size_t *tam, int *ok) {
+  char *buf = NULL;
+  FILE *f = open_memstream(&buf, tam);
+  if (!f) exit(EXIT_FAILURE);
+  fprintf(f, "arquivo: %s\n", arquivo);
+  struct grafo *g = le(arquivo, l->binario, l->fluxo);
+  *ok = g != NULL;
+  if (g) {
+    relata(f, g, l->fluxo);
+    destroi_grafo(g);
+  } else {
+    fprintf(f, "erro: não foi possível ler\n");
+  }
+  if (fclose(f) != 0 || !buf) exit(EXIT_FAILURE);
+  return buf;
+}
+
+static void *trabalhador(void *arg) {
+  lote_trabalho *l = arg;
+  pthread_mutex_lock(&l->trava);
+  for (;;) {
+    while (l->proximo < l->n && l->proximo >= l->escritos + l->janela)
+      pthread_cond_wait(&l->mudou, &l->trava);
+    if (l->proximo >= l->n) break;
+    size_t i = l->proximo++;
+    pthread_mutex_unlock(&l->trava);
+    size_t tam;
+    int ok;
+    char *r = analisa_arquivo(l, l->arquivos[i], &tam, &ok);
+    pthread_mutex_lock(&l->trava);
+    l->relatorios[i] = r;
+    l->tamanhos[i] = tam;
+    if (!ok) l->falhas++;
+    pthread_cond_broadcast(&l->mudou);
+  }
+  pthread_mutex_unlock(&l->trava);
+  return NULL;
+}
+
+// Analisa os arquivos dados pelos caminhos (ou, sem caminhos, pela entrada
+// padrão) com n_trabalhadores threads. Devolve o número de falhas.
+static int lote(char **caminhos, int n_caminhos, unsigned int n_trabalhadores,
+                int binario, int fluxo) {
+  lista arquivos = { NULL, 0, 0 };
+  int falhas = 0;
+  if (n_caminhos == 0) {
+    char *linha = NULL;
+    size_t cap = 0;
+    ssize_t len;
+    while ((len = getline(&linha, &cap, stdin)) > 0) {
+      while (len > 0 && (linha[len - 1] == '\n' || linha[len - 1] == '\r')) linha[--len] = '\0';
+      if (len > 0) acrescenta(&arquivos, linha);
+    }
+    free(linha);
+  }
+  for (int i = 0; i < n_caminhos; i++) {
+    struct stat st;
+    if (stat(caminhos[i], &st) == 0 && S_ISDIR(st.st_mode)) {
+      if (!acrescenta_diretorio(&arquivos, caminhos[i])) {
+        fprintf(stderr, "teste: não foi possível ler %s\n", caminhos[i]);
+        falhas++;
+      }
+    } else {
+      acrescenta(&arquivos, caminhos[i]);
+    }
+  }
+
+  // Cada grafo em uma thread
+  define_threads(1);
+  if (n_trabalhadores > arquivos.n) n_trabalhadores = arquivos.n ? (unsigned int)arquivos.n : 1;
+
+  lote_trabalho l;
+  memset(&l, 0, sizeof(l));
+  l.arquivos = arquivos.itens;
+  l.n = arquivos.n;
+  l.binario = binario;
+  l.fluxo = fluxo;
+  l.janela = (size_t)JANELA_LOTE * n_trabalhadores;
+  l.relatorios = calloc(l.n + 1, sizeof(char *));
+  l.tamanhos = calloc(l.n + 1, sizeof(size_t));
+  if (!l.relatorios || !l.tamanhos) exit(EXIT_FAILURE);
+  pthread_mutex_init(&l.trava, NULL);
+  pthread_cond_init(&l.mudou, NULL);
+
+  pthread_t *th = malloc(n_trabalhadores * sizeof(pthread_t));
+  if (!th) exit(EXIT_FAILURE);
+  for (unsigned int i = 0; i < n_trabalhadores; i++) {
+    if (pthread_create(&th[i], NULL, trabalhador, &l) != 0) exit(EXIT_FAILURE);
+  }
+
+  // Escreve os relatórios em ordem; como no servidor, só entrega a saída
+  // antes de esperar
+  for (size_t i = 0; i < l.n; i++) {
+    pthread_mutex_lock(&l.trava);
+    if (!l.relatorios[i]) {
+      pthread_mutex_unlock(&l.trava);
+      fflush(stdout);
+      pthread_mutex_lock(&l.trava);
+      while (!l.relatorios[i]) pthread_cond_wait(&l.mudou, &l.trava);
+    }
+    char *r = l.relatorios[i];
+    l.relatorios[i] = NULL;
+    l.escritos++;
+    pthread_cond_broadcast(&l.mudou);
+    pthread_mutex_unlock(&l.trava);
+    fwrite(r, 1, l.tamanhos[i], stdout);
+    free(r);
+  }
+  fflush(stdout);
+
+  for (unsigned int i = 0; i < n_trabalhadores; i++) pthread_join(th[i], NULL);
+  free(th);
+  pthread_cond_destroy(&l.mudou);
+  pthread_mutex_destroy(&l.trava);
+  falhas += l.falhas;
+  free(l.relatorios);
+  free(l.tamanhos);
+  for (size_t i = 0; i < arquivos.n; i++) free(arquivos.itens[i]);
+  free(arquivos.itens);
+  return falhas;
+}
+
+//------------------------------------------------------------------------------
+int main(int argc, char **argv) {
 
-  printf("grafo: %s\n", nome(g));
-  printf("%d vertices\n", n_vertices(g));
-  printf("%d arestas\n", n_arestas(g));
-  printf("%d componentes\n", n_componentes(g));
+  static const struct option longas[] = {
+    { "stream", no_argument, NULL, 'S' },
+    { "servidor", optional_argument, NULL, 'D' },
+    { "lote", no_argument, NULL, 'L' },
+    { NULL, 0, NULL, 0 }
+  };
+  const char *imagem = NULL, *medidas = NULL, *soquete = NULL;
+  int binario = 0, fluxo = 0, serve = 0, em_lote = 0, opt;
+  unsigned int threads = 0;
 
-  printf("%sbipartido\n", bipartido(g) ? "" : "não ");
+  while ((opt = getopt_long(argc, argv, "spzao:b:t:j:", longas, NULL)) != -1) {
+    switch (opt) {
+    case 's': binario = 1; break;
+    case 'p': define_estrategia_biconexidade(BICONEXIDADE_PARALELA); break;
+    case 'z': define_compressao(1); break;
+    case 'a': agrupamento = 1; break;
+    case 'o':
+      if (strcmp(optarg, "rcm") == 0) define_reordenacao(REORDENACAO_RCM);
+      else if (strcmp(optarg, "grau") == 0) define_reordenacao(REORDENACAO_GRAU);
+      else if (strcmp(optarg, "nenhuma") != 0) uso();
+      break;
+    case 'S': fluxo = 1; break;
+    case 'D': serve = 1; soquete = optarg; break;
+    case 'L': em_lote = 1; break;
+    case 'j': medidas = optarg; define_instrumentacao(1); break;
+    case 'b': imagem = optarg; break;
+    case 't':
+      threads = (unsigned int)strtoul(optarg, NULL, 10);
+      define_threads(threads);
+      break;
+    default: uso();
+    }
+  }
+  if (fluxo && (binario || imagem)) uso();
+  if (em_lote) {
+    if (serve || imagem) uso();
+    long n = threads ? (long)threads : sysconf(_SC_NPROCESSORS_ONLN);
+    int falhas = lote(argv + optind, argc - optind, n > 0 ? (unsigned int)n : 1,
+                      binario, fluxo);
+    if (!grava_medidas(medidas)) falhas = 1;
+    return falhas ? 1 : 0;
+  }
+  if (argc - optind > 1 || (binario && optind == argc)) uso();
+  if (serve) {
+    if (fluxo || binario || imagem || medidas || optind < argc) uso();
+    long n = threads ? (long)threads : sysconf(_SC_NPROCESSORS_ONLN);
+    return servidor(soquete, n > 0 ? (unsigned int)n : 1);
+  }
 
-  printf("diâmetros: %s\n", s=diametros(g));
-  free(s);
+  const char *arquivo = optind < argc ? argv[optind] : NULL;
+  struct grafo *g = le(arquivo, binario, fluxo);
 
-  printf("vértices de corte: %s\n", s=vertices_corte(g));
-  free(s);
+  if (!g) {
+    fprintf(stderr, "teste: não foi possível ler %s\n", arquivo);
+    return 1;
+  }
 
-  printf("arestas de corte: %s\n", s=arestas_corte(g));
-  free(s);
+  if (imagem) {
+    if (!salva_grafo_binario(g, imagem)) {
+      fprintf(stderr, "teste: não foi possível gravar %s\n", imagem);
+      termina(g, medidas);
+      return 1;
+    }
+    return termina(g, medidas);
+  }
 
-  return ! destroi_grafo(g);
+  relata(stdout, g, fluxo);
+  return termina(g, medidas);
 }